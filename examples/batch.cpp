@@ -0,0 +1,52 @@
+#include <atomic>
+#include <cassert>
+#include <cstdio>
+#include "common.hpp"
+#include "porc/batch.hpp"
+
+/*
+    Decrypt a batch of ciphertexts with common first block
+    using a pool of workers. Common block is attacked once.
+*/
+
+static std::atomic<size_t> queries = 0;
+
+bool is_padded(const porc::cipher_desc &opt)
+{
+    ++queries;
+    return cbc_aes256_decrypt(opt.iv, key, opt.ciphertext).has_value();
+}
+
+int main(void)
+{
+    std::vector<std::vector<uint8_t>> pts;
+    porc::batch_decryptor batch(porc::pkcs7_get_byte);
+    for (uint8_t i = 0; i < 6; ++i) {
+        auto pt = data_2blocks;
+        pt.back() ^= i;
+        pts.push_back(pt);
+        batch.add(iv, cbc_aes256_encrypt(iv, key, pt));
+    }
+
+    porc::batch_options opts;
+    opts.workers = 4;
+    size_t done = batch.run(is_padded, [&](size_t id, const std::vector<uint8_t> &pt) {
+        printf("%zu ", id);
+        hexdump("plaintext: ", pt);
+        assert(std::equal(pts[id].begin(), pts[id].end(), pt.begin()));
+    }, opts);
+    printf("decrypted: %zu oracle queries: %zu\n", done, batch.queries());
+    assert(done == pts.size());
+    assert(queries == batch.queries());
+
+    // budget is too small to decrypt anything new
+    porc::batch_decryptor limited(porc::pkcs7_get_byte, batch.cache());
+    limited.add(iv, cbc_aes256_encrypt(iv, key, data2_1block));
+    limited.add(iv, cbc_aes256_encrypt(iv, key, pts[3]));
+    opts.max_queries = 100;
+    done = limited.run(is_padded, [&](size_t id, const std::vector<uint8_t> &) {
+        assert(id == 1);
+    }, opts);
+    printf("decrypted with budget: %zu oracle queries: %zu\n", done, limited.queries());
+    assert(done == 1 && limited.queries() <= opts.max_queries);
+}
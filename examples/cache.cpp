@@ -0,0 +1,70 @@
+#include <cassert>
+#include <cstdio>
+#include "common.hpp"
+#include "porc/porc.hpp"
+
+/*
+    Padding oracle attack on several ciphertexts with a common first block.
+    Intermediate values of decrypted blocks are cached
+    so shared blocks are only attacked once.
+    Blocks taken from cache are reported by on_block like decrypted ones.
+*/
+
+static size_t queries = 0;
+
+bool is_padded(const porc::cipher_desc &opt)
+{
+    ++queries;
+    return cbc_aes256_decrypt(opt.iv, key, opt.ciphertext).has_value();
+}
+
+std::vector<uint8_t> decrypt(const std::vector<uint8_t> &ct, std::shared_ptr<porc::intermediate_cache> cache)
+{
+    porc::decryptor p(iv, ct, porc::pkcs7_get_byte, cache);
+    std::vector<uint8_t> blocks(ct.size());
+    size_t reported = 0;
+    p.on_block([&](size_t block, porc::byte_span pt) {
+        std::copy(pt.begin(), pt.end(), blocks.begin() + block * pt.size());
+        ++reported;
+    });
+    while (p.status() != porc::dec_status::DONE) {
+        auto o = std::find_if(p.begin(), p.end(), porc::check_opt_f(is_padded));
+        p.step(o);
+    }
+    hexdump("plaintext: ", p.plaintext());
+    assert(reported == p.block_count() && blocks == p.plaintext().to_vector());
+    return p.plaintext().to_vector();
+}
+
+int main(void)
+{
+    std::vector<uint8_t> other = data_2blocks;
+    other.back() ^= 0x55;
+
+    auto cache = std::make_shared<porc::intermediate_cache>();
+    std::vector<size_t> counts;
+    for(auto &pt : { data_2blocks, other, data_2blocks }) {
+        auto ct = cbc_aes256_encrypt(iv, key, pt);
+        hexdump("ciphertext: ", ct);
+        queries = 0;
+        auto pdec = decrypt(ct, cache);
+        assert(std::equal(pt.begin(), pt.end(), pdec.begin()));
+        printf("oracle queries: %zu\n", queries);
+        counts.push_back(queries);
+    }
+    // first block is shared, the same ciphertext again is free
+    assert(counts[1] < counts[0]);
+    assert(counts[2] == 0);
+
+    const char *path = "porc-cache.bin";
+    bool saved = cache->save(path);
+    assert(saved);
+    auto loaded = std::make_shared<porc::intermediate_cache>();
+    bool ok = loaded->load(path);
+    assert(ok && loaded->size() == cache->size());
+    remove(path);
+
+    queries = 0;
+    decrypt(cbc_aes256_encrypt(iv, key, other), loaded);
+    assert(queries == 0);
+}
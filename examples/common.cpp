@@ -4,19 +4,11 @@
 #include <openssl/evp.h>
 #include "common.hpp"
 
-void hexdump(const std::string &header, const std::vector<uint8_t> &v)
+void hexdump(const std::string &header, const uint8_t *data, size_t size)
 {
     printf("%s", header.c_str());
-    for(auto i : v)
-        printf("%02X", i);
-    printf("\n");
-}
-
-void hexdump(const std::string &header, const std::deque<uint8_t> &v)
-{
-    printf("%s", header.c_str());
-    for(auto i : v)
-        printf("%02X", i);
+    for(size_t i = 0; i < size; ++i)
+        printf("%02X", data[i]);
     printf("\n");
 }
 
@@ -1,4 +1,3 @@
-#include <deque>
 #include <optional>
 #include <vector>
 #include <string>
@@ -29,8 +28,13 @@ const std::vector<uint8_t> data2_1block = {
     0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28, 0x29, 0xB0, 0xB1, 0xB2, 0xB3, 0xB4
 };
 
-void hexdump(const std::string &header, const std::vector<uint8_t> &v);
-void hexdump(const std::string &header, const std::deque<uint8_t> &v);
+void hexdump(const std::string &header, const uint8_t *data, size_t size);
+
+template <typename T>
+void hexdump(const std::string &header, const T &v)
+{
+    hexdump(header, v.data(), v.size());
+}
 
 std::vector<uint8_t> cbc_aes256_encrypt(
     const std::vector<uint8_t> &iv,
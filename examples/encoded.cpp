@@ -0,0 +1,48 @@
+#include <cassert>
+#include <cstdio>
+#include <openssl/evp.h>
+
+#include "porc/encoder.hpp"
+#include "common.hpp"
+
+/*
+    Padding oracle that takes base64 of iv || ciphertext, like most web services do.
+    Encoder reuses one buffer and only encodes the bytes that changed since the last query.
+*/
+
+const size_t block_size = 16;
+
+bool is_padded_base64(const std::string &s)
+{
+    std::vector<uint8_t> raw(s.size() / 4 * 3);
+    int n = EVP_DecodeBlock(raw.data(), (const unsigned char*)s.data(), s.size());
+    assert(n >= 0);
+    raw.resize(n - std::count(s.end() - 2, s.end(), '='));
+
+    std::vector<uint8_t> in_iv(raw.begin(), raw.begin() + block_size);
+    std::vector<uint8_t> in_ct(raw.begin() + block_size, raw.end());
+    return cbc_aes256_decrypt(in_iv, key, in_ct).has_value();
+}
+
+std::vector<uint8_t> decrypt(const std::vector<uint8_t> &ct)
+{
+    porc::encoded_oracle oracle(porc::encoding::BASE64, is_padded_base64);
+    porc::decryptor p(iv, ct, porc::pkcs7_get_byte);
+    while (p.status() != porc::dec_status::DONE) {
+        auto o = std::find_if(p.begin(), p.end(), porc::check_opt_f(oracle));
+        p.step(o);
+    }
+    hexdump("plaintext: ", p.plaintext());
+    return p.plaintext().to_vector();
+}
+
+int main(void)
+{
+    for(auto &pt : { data_2blocks, data2_1block }) {
+        hexdump("plaintext:  ", pt);
+        auto ct = cbc_aes256_encrypt(iv, key, pt);
+        hexdump("ciphertext: ", ct);
+        auto pdec = decrypt(ct);
+        assert(std::equal(pt.begin(), pt.end(), pdec.begin()));
+    }
+}
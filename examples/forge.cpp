@@ -0,0 +1,51 @@
+#include <cassert>
+#include <cstdio>
+#include "common.hpp"
+#include "porc/encryptor.hpp"
+
+/*
+    Padding oracle used to encrypt chosen plaintext without the key (CBC-R).
+    Plaintexts with common ending share most of the oracle work.
+*/
+
+static size_t queries = 0;
+
+bool is_padded(const porc::cipher_desc &opt)
+{
+    ++queries;
+    return cbc_aes256_decrypt(opt.iv, key, opt.ciphertext).has_value();
+}
+
+porc::cipher_desc forge(const std::vector<uint8_t> &pt, std::shared_ptr<porc::intermediate_cache> cache)
+{
+    const std::vector<uint8_t> last_block(16, 0x42);
+    porc::encryptor e(pt, last_block, porc::pkcs7_get_byte, cache);
+    while (e.status() != porc::dec_status::DONE) {
+        auto o = std::find_if(e.begin(), e.end(), porc::check_opt_f(is_padded));
+        if (e.step(o) != porc::dec_status::NONE)
+            printf("blocks forged: %zu / %zu\n", e.blocks_done(), e.block_count());
+    }
+    return porc::cipher_desc(e.iv(), e.ciphertext());
+}
+
+int main(void)
+{
+    auto cache = std::make_shared<porc::intermediate_cache>();
+    std::vector<uint8_t> other = data_2blocks;
+    other[0] ^= 0x55;
+
+    std::vector<size_t> counts;
+    for(auto &pt : { data_2blocks, other }) {
+        hexdump("plaintext:  ", pt);
+        queries = 0;
+        auto f = forge(pt, cache);
+        hexdump("iv:         ", f.iv);
+        hexdump("ciphertext: ", f.ciphertext);
+        printf("oracle queries: %zu\n", queries);
+        counts.push_back(queries);
+
+        auto dec = cbc_aes256_decrypt(f.iv, key, f.ciphertext);
+        assert(dec && dec.value() == pt);
+    }
+    assert(counts[1] < counts[0]);
+}
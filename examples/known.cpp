@@ -0,0 +1,64 @@
+#include <cassert>
+#include <cstdio>
+
+#include "porc/porc.hpp"
+#include "common.hpp"
+
+/*
+    Part of plaintext is known in advance (message header, padding),
+    its bytes cost no searches, only one verification query per block.
+    Wrong guess is caught by verification, or by a byte with no good option
+    when the guess is in the middle of a block, and searched for instead.
+*/
+
+size_t queries = 0;
+
+bool is_padded(const porc::cipher_desc &opt)
+{
+    ++queries;
+    return cbc_aes256_decrypt(opt.iv, key, opt.ciphertext).has_value();
+}
+
+std::vector<uint8_t> decrypt(const std::vector<uint8_t> &ct, size_t offset, const std::vector<uint8_t> &known)
+{
+    porc::decryptor p(iv, ct, porc::pkcs7_get_byte);
+    p.set_known(offset, known);
+    p.set_known(ct.size() - 2, { 0x02, 0x02 });
+    queries = 0;
+    while (p.status() != porc::dec_status::DONE) {
+        if (p.status() == porc::dec_status::VERIFY) {
+            p.verified(is_padded(p.verification()));
+            continue;
+        }
+
+        auto o = std::find_if(p.begin(), p.end(), porc::check_opt_f(is_padded));
+        if (o == p.end()) {
+            // a known byte after this one is wrong
+            bool ok = p.no_good_option();
+            assert(ok);
+            continue;
+        }
+        p.step(o);
+    }
+    printf("oracle queries: %zu\n", queries);
+    hexdump("plaintext: ", p.plaintext());
+    return p.plaintext().to_vector();
+}
+
+int main(void)
+{
+    auto &pt = data_2blocks;
+    hexdump("plaintext:  ", pt);
+    auto ct = cbc_aes256_encrypt(iv, key, pt);
+    hexdump("ciphertext: ", ct);
+    auto pdec = decrypt(ct, 0, { 0x11, 0x12, 0x13, 0x14 });
+    assert(std::equal(pt.begin(), pt.end(), pdec.begin()));
+
+    // wrong guess of the third byte
+    pdec = decrypt(ct, 0, { 0x11, 0x12, 0x33, 0x14 });
+    assert(std::equal(pt.begin(), pt.end(), pdec.begin()));
+
+    // wrong guess in the middle of a block, the byte before it has no good option
+    pdec = decrypt(ct, 5, { 0x16, 0x99 });
+    assert(std::equal(pt.begin(), pt.end(), pdec.begin()));
+}
@@ -0,0 +1,62 @@
+#include <cassert>
+#include <cstdio>
+#include <random>
+#include <unistd.h>
+
+#include "porc/posterior.hpp"
+#include "common.hpp"
+
+/*
+    Noisy oracles without a yes / no decision per option:
+    every answer updates probabilities of all options of a byte,
+    the next query goes where it's expected to tell the most.
+    - yes / no oracle that gets 5% of answers wrong both ways
+    - timing based oracle, few measurements per query
+*/
+
+std::mt19937 rng(1);
+
+bool is_padded(porc::cipher_desc &opt)
+{
+    bool res = cbc_aes256_decrypt(opt.iv, key, opt.ciphertext).has_value();
+    return rng() % 20 == 0 ? !res : res;
+}
+
+void cbc_decrypt(const std::vector<uint8_t> &iv, const std::vector<uint8_t> &ct)
+{
+    if(cbc_aes256_decrypt(iv, key, ct).has_value())
+        usleep(20); // timing leak
+}
+
+std::vector<uint8_t> decrypt(const std::vector<uint8_t> &ct, const porc::evidence &e)
+{
+    porc::decryptor p(iv, ct, porc::pkcs7_get_byte, nullptr, true);
+    porc::posterior_runner r(e);
+    bool ok = r.run(p);
+    assert(ok);
+
+    double worst = 1;
+    for (size_t b = 0; b < p.block_count(); ++b)
+        for (size_t i = 0; i < p.block_size(); ++i)
+            worst = std::min(worst, p.confidence(b, i));
+    printf("oracle queries: %zu, least confident byte: %f\n", r.queries(), worst);
+    hexdump("plaintext: ", p.plaintext());
+    return p.plaintext().to_vector();
+}
+
+int main(void)
+{
+    for(auto &pt : { data_2blocks, data2_1block }) {
+        hexdump("plaintext:  ", pt);
+        auto ct = cbc_aes256_encrypt(iv, key, pt);
+        hexdump("ciphertext: ", ct);
+        auto pdec = decrypt(ct, porc::bool_evidence(is_padded, 0.05, 0.05));
+        assert(std::equal(pt.begin(), pt.end(), pdec.begin()));
+
+        std::vector<uint8_t> bad_ct = ct;
+        bad_ct[bad_ct.size() - 1] ^= 0x12;
+        auto c = porc::calibrate_ns(cbc_decrypt, porc::cipher_desc(iv, ct), porc::cipher_desc(iv, bad_ct), 100, 0.01);
+        pdec = decrypt(ct, porc::timing_evidence(cbc_decrypt, c, 3));
+        assert(std::equal(pt.begin(), pt.end(), pdec.begin()));
+    }
+}
@@ -0,0 +1,116 @@
+#include <cassert>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <openssl/evp.h>
+
+#include "porc/probe.hpp"
+#include "common.hpp"
+
+/*
+    Oracles of two services that take a single token:
+    - IV || ciphertext with pkcs7, sometimes says bad padding is good
+    - ciphertext with ISO 7816-4 padding and a fixed IV known only to the server
+    Probing finds the format, then the token is decrypted as found.
+*/
+
+std::mt19937 rng(1);
+const std::vector<uint8_t> server_iv(16, 0x5A);
+
+std::vector<uint8_t> aes_cbc_raw(bool enc, const std::vector<uint8_t> &iv, const std::vector<uint8_t> &data)
+{
+    std::unique_ptr<EVP_CIPHER_CTX, decltype(&::EVP_CIPHER_CTX_free)> ctx(EVP_CIPHER_CTX_new(), EVP_CIPHER_CTX_free);
+    int ret = EVP_CipherInit_ex(ctx.get(), EVP_aes_256_cbc(), NULL, key.data(), iv.data(), enc);
+    assert(ret == 1);
+    EVP_CIPHER_CTX_set_padding(ctx.get(), 0);
+    std::vector<uint8_t> res(data.size());
+    int len;
+    ret = EVP_CipherUpdate(ctx.get(), res.data(), &len, data.data(), data.size());
+    assert(ret == 1 && (size_t)len == data.size());
+    return res;
+}
+
+bool pkcs7_token_padded(const std::vector<uint8_t> &token)
+{
+    if (rng() % 50 == 0)
+        return true; // false positives
+    if (token.size() < 32)
+        return false;
+    std::vector<uint8_t> tiv(token.begin(), token.begin() + 16);
+    std::vector<uint8_t> ct(token.begin() + 16, token.end());
+    return cbc_aes256_decrypt(tiv, key, ct).has_value();
+}
+
+bool iso_token_padded(const std::vector<uint8_t> &token)
+{
+    if (token.empty() || token.size() % 16 != 0)
+        return false;
+    auto pt = aes_cbc_raw(false, server_iv, token);
+    size_t i = pt.size() - 1;
+    while (i > pt.size() - 16 && pt[i] == 0)
+        --i;
+    return pt[i] == 0x80;
+}
+
+std::vector<uint8_t> decrypt(const std::vector<uint8_t> &token,
+                             std::function<bool(const std::vector<uint8_t>&)> f,
+                             const porc::probe_options &opts,
+                             std::optional<bool> iv_prepended)
+{
+    auto r = porc::probe(token, f, opts);
+    assert(r && r->iv_prepended == iv_prepended);
+    printf("block size: %zu, %s padding of %zu, IV %s, reliability %.3f, %zu queries\n",
+           r->block_size, r->padding == porc::padding_scheme::PKCS7 ? "pkcs7" : "ISO 7816-4",
+           r->padding_length, !r->iv_prepended ? "not tested" : *r->iv_prepended ? "prepended" : "fixed",
+           r->reliability, r->queries);
+
+    auto is_padded = porc::message_oracle(f);
+    auto p = r->make_decryptor();
+    while (p.status() != porc::dec_status::DONE) {
+        if (p.status() == porc::dec_status::VERIFY) {
+            auto v = p.verification();
+            bool good = true;
+            for (size_t i = 0; good && i < 5; ++i)
+                good = is_padded(v);
+            p.verified(good);
+            continue;
+        }
+
+        auto o = std::find_if(p.begin(), p.end(), [&](porc::dec_option &opt) {
+            return porc::check_opt(is_padded, opt) && porc::check_opt(is_padded, opt) &&
+                   porc::check_opt(is_padded, opt);
+        });
+        if (o == p.end()) {
+            p.step(p.begin(), 1);
+            continue;
+        }
+        p.step(o, porc::check_opt(is_padded, *o) ? 1 : 0.5);
+    }
+    hexdump("plaintext: ", p.plaintext());
+    return p.plaintext().to_vector();
+}
+
+int main(void)
+{
+    setvbuf(stdout, NULL, _IONBF, 0);
+    hexdump("plaintext:  ", data_2blocks);
+    auto token = iv;
+    auto ct = cbc_aes256_encrypt(iv, key, data_2blocks);
+    token.insert(token.end(), ct.begin(), ct.end());
+    hexdump("token: ", token);
+    auto pdec = decrypt(token, pkcs7_token_padded, porc::probe_options(), std::nullopt);
+    assert(std::equal(data_2blocks.begin(), data_2blocks.end(), pdec.begin()));
+
+    auto pt = data_2blocks;
+    pt.push_back(0xC0);
+    hexdump("plaintext:  ", pt);
+    pt.push_back(0x80);
+    token = aes_cbc_raw(true, server_iv, pt);
+    hexdump("token: ", token);
+    // first block is decrypted with the server IV, out of reach.
+    // Look for it, missed 1% of the time
+    porc::probe_options opts;
+    opts.iv_queries = 1180;
+    pdec = decrypt(token, iso_token_padded, opts, false);
+    assert(std::equal(pt.begin() + 16, pt.end(), pdec.begin()));
+}
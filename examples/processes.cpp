@@ -0,0 +1,47 @@
+#include <cassert>
+#include <cstdio>
+#include <unistd.h>
+
+#include "porc/process_pool.hpp"
+#include "common.hpp"
+
+/*
+    Padding oracle that can't be called from several threads at once
+    and takes a while to answer. Forked workers run it in parallel anyway.
+*/
+
+bool is_padded(const porc::cipher_desc &opt)
+{
+    static bool busy = false;
+    static size_t calls = 0;
+    assert(!busy);
+    busy = true;
+    ++calls;
+    usleep(100);
+    bool res = cbc_aes256_decrypt(opt.iv, key, opt.ciphertext).has_value();
+    busy = false;
+    return res;
+}
+
+std::vector<uint8_t> decrypt(const std::vector<uint8_t> &ct)
+{
+    porc::process_pool pool(is_padded, 4, iv.size() + ct.size());
+    porc::decryptor p(iv, ct, porc::pkcs7_get_byte);
+    while (p.status() != porc::dec_status::DONE) {
+        p.step(pool.find(p));
+        hexdump("pt: ", p.plaintext());
+    }
+    hexdump("plaintext: ", p.plaintext());
+    return p.plaintext().to_vector();
+}
+
+int main(void)
+{
+    for(auto &pt : { data_2blocks, data2_1block }) {
+        hexdump("plaintext:  ", pt);
+        auto ct = cbc_aes256_encrypt(iv, key, pt);
+        hexdump("ciphertext: ", ct);
+        auto pdec = decrypt(ct);
+        assert(std::equal(pt.begin(), pt.end(), pdec.begin()));
+    }
+}
@@ -0,0 +1,83 @@
+#include <cassert>
+#include <cstdio>
+#include <memory>
+#include <openssl/evp.h>
+
+#include "porc/response.hpp"
+#include "common.hpp"
+
+/*
+    Padding oracle with more than two kinds of responses:
+    bad padding is an error, good padding is answered with plaintext length
+    (think of Content-Length of a response that echoes the message).
+    Responses of different padding lengths differ,
+    so false positives are spotted without asking the oracle again
+    once the first block is decrypted.
+    Same for a service with ISO 7816-4 padding, where every byte but the first
+    of a block has false positives.
+*/
+
+uint64_t respond(const porc::cipher_desc &opt)
+{
+    auto pt = cbc_aes256_decrypt(opt.iv, key, opt.ciphertext);
+    return pt ? 200 + pt->size() : 500;
+}
+
+std::vector<uint8_t> aes_cbc_raw(bool enc, const std::vector<uint8_t> &iv, const std::vector<uint8_t> &data)
+{
+    std::unique_ptr<EVP_CIPHER_CTX, decltype(&::EVP_CIPHER_CTX_free)> ctx(EVP_CIPHER_CTX_new(), EVP_CIPHER_CTX_free);
+    int ret = EVP_CipherInit_ex(ctx.get(), EVP_aes_256_cbc(), NULL, key.data(), iv.data(), enc);
+    assert(ret == 1);
+    EVP_CIPHER_CTX_set_padding(ctx.get(), 0);
+    std::vector<uint8_t> res(data.size());
+    int len;
+    ret = EVP_CipherUpdate(ctx.get(), res.data(), &len, data.data(), data.size());
+    assert(ret == 1 && (size_t)len == data.size());
+    return res;
+}
+
+uint64_t respond_iso(const porc::cipher_desc &opt)
+{
+    auto pt = aes_cbc_raw(false, opt.iv, opt.ciphertext);
+    size_t n = pt.size();
+    while (n > 0 && pt[n - 1] == 0x00)
+        --n;
+    return n > 0 && pt[n - 1] == 0x80 ? 200 + n - 1 : 500;
+}
+
+std::vector<uint8_t> decrypt(const std::vector<uint8_t> &ct,
+                             std::function<uint64_t(porc::cipher_desc&)> f,
+                             std::function<uint8_t(size_t, size_t)> get_padding_byte)
+{
+    porc::response_oracle oracle(f);
+    porc::decryptor p(iv, ct, get_padding_byte);
+    while (p.status() != porc::dec_status::DONE)
+        p.step(oracle.find(p));
+    printf("queries: %zu, false_pos_check queries saved: %zu\n", oracle.queries(), oracle.saved());
+    assert(p.block_count() == 1 || oracle.saved() > 0);
+    hexdump("plaintext: ", p.plaintext());
+    return p.plaintext().to_vector();
+}
+
+int main(void)
+{
+    std::vector<uint8_t> data_4blocks = data_2blocks;
+    data_4blocks.insert(data_4blocks.end(), data_2blocks.begin(), data_2blocks.end());
+    for(auto &pt : { data_4blocks, data_2blocks, data2_1block }) {
+        hexdump("plaintext:  ", pt);
+        auto ct = cbc_aes256_encrypt(iv, key, pt);
+        hexdump("ciphertext: ", ct);
+        auto pdec = decrypt(ct, respond, porc::pkcs7_get_byte);
+        assert(std::equal(pt.begin(), pt.end(), pdec.begin()));
+    }
+
+    // ISO 7816-4 padding of length 3, response size depends on it
+    std::vector<uint8_t> pt = data_2blocks;
+    pt.resize(29);
+    pt.insert(pt.end(), { 0x80, 0x00, 0x00 });
+    hexdump("plaintext:  ", pt);
+    auto ct = aes_cbc_raw(true, iv, pt);
+    hexdump("ciphertext: ", ct);
+    auto pdec = decrypt(ct, respond_iso, porc::iso7816_get_byte_f(16));
+    assert(pdec == pt);
+}
@@ -12,15 +12,19 @@ bool is_padded(const porc::cipher_desc &opt)
     return cbc_aes256_decrypt(opt.iv, key, opt.ciphertext).has_value();
 }
 
-std::deque<uint8_t> decrypt(const std::vector<uint8_t> &ct)
+std::vector<uint8_t> decrypt(const std::vector<uint8_t> &ct)
 {
     porc::decryptor p(iv, ct, porc::pkcs7_get_byte);
+    p.on_block([](size_t block, porc::byte_span pt) {
+        printf("block %zu: ", block);
+        hexdump("", pt);
+    });
     while (p.status() != porc::dec_status::DONE) {
         auto o = std::find_if(p.begin(), p.end(), porc::check_opt_f(is_padded));
         p.step(o);
     }
     hexdump("plaintext: ", p.plaintext());
-    return p.plaintext();
+    return p.plaintext().to_vector();
 }
 
 int main(void)
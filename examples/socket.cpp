@@ -0,0 +1,122 @@
+#include <arpa/inet.h>
+#include <cassert>
+#include <csignal>
+#include <cstdio>
+#include <map>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/prctl.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "porc/socket_oracle.hpp"
+#include "common.hpp"
+
+/*
+    Padding oracle behind a line-based TCP service:
+    "CHECK <hex of iv || ciphertext>\n" is answered with "OK\n" or "BAD PADDING\n".
+    Stand-in server runs in a child process on loopback
+    and closes every connection after 100 requests, like keep-alive limits do.
+*/
+
+const size_t max_requests = 100;
+
+std::string answer(const std::string &line)
+{
+    std::string hex = line.substr(line.find(' ') + 1);
+    std::vector<uint8_t> raw;
+    for (size_t i = 0; i + 1 < hex.size(); i += 2)
+        raw.push_back(std::stoi(hex.substr(i, 2), nullptr, 16));
+    std::vector<uint8_t> in_iv(raw.begin(), raw.begin() + 16);
+    std::vector<uint8_t> in_ct(raw.begin() + 16, raw.end());
+    return cbc_aes256_decrypt(in_iv, key, in_ct) ? "OK\n" : "BAD PADDING\n";
+}
+
+void serve(int listen_fd)
+{
+    std::vector<pollfd> fds = { { listen_fd, POLLIN, 0 } };
+    std::map<int, std::pair<std::string, size_t>> clients;
+    for (;;) {
+        poll(fds.data(), fds.size(), -1);
+        for (size_t i = fds.size(); i-- > 1;) {
+            if (!fds[i].revents)
+                continue;
+            int fd = fds[i].fd;
+            auto &[buf, served] = clients[fd];
+            char tmp[4096];
+            ssize_t n = read(fd, tmp, sizeof(tmp));
+            if (n > 0)
+                buf.append(tmp, n);
+
+            size_t nl;
+            while (served < max_requests && (nl = buf.find('\n')) != std::string::npos) {
+                auto res = answer(buf.substr(0, nl));
+                buf.erase(0, nl + 1);
+                send(fd, res.data(), res.size(), MSG_NOSIGNAL);
+                ++served;
+            }
+            if (n <= 0 || served >= max_requests) {
+                close(fd);
+                clients.erase(fd);
+                fds.erase(fds.begin() + i);
+            }
+        }
+        if (fds[0].revents)
+            fds.push_back({ accept(listen_fd, nullptr, nullptr), POLLIN, 0 });
+    }
+}
+
+std::vector<uint8_t> decrypt(const std::vector<uint8_t> &ct, const std::string &address)
+{
+    porc::socket_oracle oracle(
+        address,
+        porc::request_template("CHECK {data}\n", porc::encoding::HEX),
+        porc::frame_line,
+        [](std::string_view response) { return response == "OK\n"; });
+    assert(oracle.ok());
+
+    porc::decryptor p(iv, ct, porc::pkcs7_get_byte);
+    while (p.status() != porc::dec_status::DONE) {
+        size_t o = oracle.find(p);
+        assert(o < 0x100);
+        p.step(o);
+    }
+    printf("requests: %zu, reconnects: %zu\n", oracle.queries(), oracle.reconnects());
+    hexdump("plaintext: ", p.plaintext());
+    return p.plaintext().to_vector();
+}
+
+int main(void)
+{
+    int listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in sa = {};
+    sa.sin_family = AF_INET;
+    sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(sa);
+    int r = bind(listen_fd, (sockaddr*)&sa, len);
+    assert(r == 0);
+    r = listen(listen_fd, 16);
+    assert(r == 0);
+    getsockname(listen_fd, (sockaddr*)&sa, &len);
+    std::string address = "127.0.0.1:" + std::to_string(ntohs(sa.sin_port));
+
+    pid_t server = fork();
+    assert(server >= 0);
+    if (server == 0) {
+        prctl(PR_SET_PDEATHSIG, SIGKILL);
+        serve(listen_fd);
+        _exit(0);
+    }
+    close(listen_fd);
+
+    for(auto &pt : { data_2blocks, data2_1block }) {
+        hexdump("plaintext:  ", pt);
+        auto ct = cbc_aes256_encrypt(iv, key, pt);
+        hexdump("ciphertext: ", ct);
+        auto pdec = decrypt(ct, address);
+        assert(std::equal(pt.begin(), pt.end(), pdec.begin()));
+    }
+    kill(server, SIGTERM);
+    waitpid(server, nullptr, 0);
+}
@@ -0,0 +1,55 @@
+#include <atomic>
+#include <cassert>
+#include <cstdio>
+#include <unistd.h>
+
+#include "porc/executor.hpp"
+#include "common.hpp"
+
+/*
+    Padding oracle that takes a while to answer
+    and refuses to work on more than 8 queries at once.
+    Executor finds how hard it can be pushed.
+*/
+
+const size_t oracle_capacity = 8;
+static std::atomic<size_t> in_flight = 0;
+
+porc::oracle_reply is_padded(const porc::cipher_desc &opt)
+{
+    if (++in_flight > oracle_capacity) {
+        --in_flight;
+        return porc::oracle_reply::THROTTLED;
+    }
+    usleep(1000);
+    bool res = cbc_aes256_decrypt(opt.iv, key, opt.ciphertext).has_value();
+    --in_flight;
+    return res ? porc::oracle_reply::GOOD_PADDING : porc::oracle_reply::BAD_PADDING;
+}
+
+std::vector<uint8_t> decrypt(const std::vector<uint8_t> &ct)
+{
+    porc::executor_options opts;
+    opts.max_concurrency = 32;
+    porc::oracle_executor ex(is_padded, opts);
+
+    porc::decryptor p(iv, ct, porc::pkcs7_get_byte);
+    while (p.status() != porc::dec_status::DONE) {
+        p.step(ex.find(p));
+        auto s = ex.stats();
+        printf("limit: %.1f max in flight: %zu throttled: %zu queries/s: %.0f ",
+               s.limit, s.max_in_flight, s.failures, s.throughput());
+        hexdump("pt: ", p.plaintext());
+    }
+    assert(ex.stats().limit < opts.max_concurrency);
+    return p.plaintext().to_vector();
+}
+
+int main(void)
+{
+    hexdump("plaintext:  ", data_2blocks);
+    auto ct = cbc_aes256_encrypt(iv, key, data_2blocks);
+    hexdump("ciphertext: ", ct);
+    auto pdec = decrypt(ct);
+    assert(std::equal(data_2blocks.begin(), data_2blocks.end(), pdec.begin()));
+}
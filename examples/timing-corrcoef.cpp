@@ -21,7 +21,7 @@ void cbc_decrypt(const std::vector<uint8_t> &iv, const std::vector<uint8_t> &ct)
         usleep(20);
 }
 
-std::deque<uint8_t> decrypt(const std::vector<uint8_t> &ct)
+std::vector<uint8_t> decrypt(const std::vector<uint8_t> &ct)
 {
     const size_t tries = 100;
     const size_t buckets = 10;
@@ -58,7 +58,7 @@ std::deque<uint8_t> decrypt(const std::vector<uint8_t> &ct)
         hexdump("pt: ", p.plaintext());
     }
     hexdump("plaintext: ", p.plaintext());
-    return p.plaintext();
+    return p.plaintext().to_vector();
 }
 
 int main(void)
@@ -22,7 +22,7 @@ void cbc_decrypt(const std::vector<uint8_t> &iv, const std::vector<uint8_t> &ct)
         usleep(calls / 10000);
 }
 
-std::deque<uint8_t> decrypt(const std::vector<uint8_t> &ct)
+std::vector<uint8_t> decrypt(const std::vector<uint8_t> &ct)
 {
     const size_t tries = 10000;
     porc::time_ns(cbc_decrypt, iv, ct, tries);
@@ -57,7 +57,7 @@ std::deque<uint8_t> decrypt(const std::vector<uint8_t> &ct)
         hexdump("pt: ", p.plaintext());
     }
     hexdump("plaintext: ", p.plaintext());
-    return p.plaintext();
+    return p.plaintext().to_vector();
 }
 
 int main(void)
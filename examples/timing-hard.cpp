@@ -17,48 +17,44 @@ void cbc_decrypt(const std::vector<uint8_t> &iv, const std::vector<uint8_t> &ct)
     cbc_aes256_decrypt(iv, key, ct);
 }
 
-std::deque<uint8_t> decrypt(const std::vector<uint8_t> &ct)
+std::vector<uint8_t> decrypt(const std::vector<uint8_t> &ct)
 {
     const size_t tries = 100000;
     porc::time_ns(cbc_decrypt, iv, ct, tries); // empty run makes measurements more consistent
 
     std::vector<uint8_t> bad_ct = ct;
     bad_ct[bad_ct.size() - 1] ^= 0x12;
-    auto bad = porc::stats::mean(porc::time_ns(cbc_decrypt, iv, bad_ct, tries));
-    auto good = porc::stats::mean(porc::time_ns(cbc_decrypt, iv, ct, tries));
-    auto bad2 = porc::stats::mean(porc::time_ns(cbc_decrypt, iv, bad_ct, tries));
+    auto c = porc::calibrate_ns(cbc_decrypt, porc::cipher_desc(iv, ct), porc::cipher_desc(iv, bad_ct),
+                                tries, 0.001);
+    printf("good: %.0Lf bad: %.0Lf sd: %.0Lf effect size: %.3Lf samples per option: %zu "
+           "expected time per byte: %.0Lf ms\n",
+           c.good_mean, c.bad_mean, c.sd, c.effect_size, c.samples, c.expected_time / 1e6);
+
+    if (c.samples > tries) {
+        printf("Good-bad case diff is too small compared to measurement error.\n"
+               "Attack will be unreliable.\n");
+    }
+    size_t samples = std::min(c.samples, tries);
 
-    auto mid = (good + bad) / 2;
     // reasonable person could think that good padding case will be slower,
     // and check for greater_good is unnecessary but optimizers are funny.
     // Also sanitizers change timings A LOT.
-    bool greater_good = good > bad;
-
-    auto diff = std::max(good, bad) - std::min(good, bad);
-    auto m_err = std::max(bad2, bad) - std::min(bad2, bad);
-    printf("good: %" PRIuMAX " bad: %" PRIuMAX " diff: %" PRIuMAX " measurement error: %" PRIuMAX "\n",
-           good, bad, diff, m_err);
-
-    if (diff < 5*m_err) {
-        printf("Good-bad case diff should be about 5 time bigger than measurement error.\n"
-               "Attack will be unreliable.");
-    }
+    bool greater_good = c.greater_good;
+    auto mid = c.threshold;
 
     porc::decryptor p(iv, ct, porc::pkcs7_get_byte);
     while (p.status() != porc::dec_status::DONE) {
         auto o = std::find_if(
             std::execution::par_unseq,
             p.begin(), p.end(), porc::check_opt_f([&](porc::cipher_desc &opt) {
-            auto m = porc::stats::mean(porc::time_ns(cbc_decrypt, opt, tries / 100));
-            //printf("g: %" PRIuMAX" b: %" PRIuMAX " m: %" PRIuMAX " r: %d\n",
-            //    good, bad, m, greater_good ? (m > mid) : (m < mid));
+            auto m = porc::stats::mean(porc::time_ns(cbc_decrypt, opt, samples));
             return greater_good ? (m > mid) : (m < mid);
         }));
         p.step(o);
         hexdump("pt: ", p.plaintext());
     }
     hexdump("plaintext: ", p.plaintext());
-    return p.plaintext();
+    return p.plaintext().to_vector();
 }
 
 int main(void)
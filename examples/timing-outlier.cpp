@@ -0,0 +1,41 @@
+#include <cassert>
+#include <cstdio>
+#include <unistd.h>
+
+#include "porc/porc.hpp"
+#include "porc/stats.hpp"
+#include "common.hpp"
+
+/*
+    Timing based padding oracle attacked without reference measurements:
+    all options of a byte are measured together
+    and the good one is the one that stands out.
+*/
+void cbc_decrypt(const std::vector<uint8_t> &iv, const std::vector<uint8_t> &ct)
+{
+    if(cbc_aes256_decrypt(iv, key, ct).has_value())
+        usleep(0); // timing leak
+}
+
+std::vector<uint8_t> decrypt(const std::vector<uint8_t> &ct)
+{
+    const size_t tries = 15;
+    porc::decryptor p(iv, ct, porc::pkcs7_get_byte);
+    while (p.status() != porc::dec_status::DONE) {
+        p.step(porc::find_outlier_ns(cbc_decrypt, p, tries));
+        hexdump("pt: ", p.plaintext());
+    }
+    hexdump("plaintext: ", p.plaintext());
+    return p.plaintext().to_vector();
+}
+
+int main(void)
+{
+    for(auto &pt : { data_2blocks, data2_1block }) {
+        hexdump("plaintext:  ", pt);
+        auto ct = cbc_aes256_encrypt(iv, key, pt);
+        hexdump("ciphertext: ", ct);
+        auto pdec = decrypt(ct);
+        assert(std::equal(pt.begin(), pt.end(), pdec.begin()));
+    }
+}
@@ -0,0 +1,53 @@
+#include <cassert>
+#include <cstdio>
+#include <unistd.h>
+
+#include "porc/porc.hpp"
+#include "porc/stats.hpp"
+#include "common.hpp"
+
+/*
+    Timing based padding oracle, every option is measured in pairs
+    with a reference input of known bad padding.
+    Slow changes of oracle timing are in both measurements of a pair and cancel out.
+*/
+void cbc_decrypt(const std::vector<uint8_t> &iv, const std::vector<uint8_t> &ct)
+{
+    if(cbc_aes256_decrypt(iv, key, ct).has_value())
+        usleep(5); // timing leak
+}
+
+std::vector<uint8_t> decrypt(const std::vector<uint8_t> &ct)
+{
+    const size_t tries = 10;
+    porc::cipher_desc good(iv, ct);
+    porc::cipher_desc bad(iv, ct);
+    bad.ciphertext[bad.ciphertext.size() - 1] ^= 0x12;
+    auto ref = porc::stats::paired(porc::time_paired_ns(cbc_decrypt, good, bad, 10 * tries));
+    printf("good - bad: median %Lf ns, t %Lf, order bias %Lf ns\n", ref.median, ref.t, ref.order_bias);
+    auto is_good = [&](const porc::cipher_desc &in) {
+        return porc::stats::paired(porc::time_paired_ns(cbc_decrypt, in, bad, tries)).median > ref.median / 2;
+    };
+
+    porc::decryptor p(iv, ct, porc::pkcs7_get_byte);
+    while (p.status() != porc::dec_status::DONE) {
+        auto o = std::find_if(p.begin(), p.end(), [&](porc::dec_option &opt) {
+            return is_good(opt.option) && (!opt.false_pos_check || is_good(opt.false_pos_check.value()));
+        });
+        p.step(o);
+        hexdump("pt: ", p.plaintext());
+    }
+    hexdump("plaintext: ", p.plaintext());
+    return p.plaintext().to_vector();
+}
+
+int main(void)
+{
+    for(auto &pt : { data_2blocks, data2_1block }) {
+        hexdump("plaintext:  ", pt);
+        auto ct = cbc_aes256_encrypt(iv, key, pt);
+        hexdump("ciphertext: ", ct);
+        auto pdec = decrypt(ct);
+        assert(std::equal(pt.begin(), pt.end(), pdec.begin()));
+    }
+}
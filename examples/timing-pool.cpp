@@ -0,0 +1,49 @@
+#include <cassert>
+#include <cstdio>
+#include <unistd.h>
+
+#include "porc/timing_pool.hpp"
+#include "common.hpp"
+
+/*
+    Timing based padding oracle measured from 4 threads pinned to their own cores,
+    every thread compares candidates only to its own good / bad padding timings.
+*/
+
+void cbc_decrypt(const std::vector<uint8_t> &iv, const std::vector<uint8_t> &ct)
+{
+    if(cbc_aes256_decrypt(iv, key, ct).has_value())
+        usleep(20); // timing leak
+}
+
+std::vector<uint8_t> decrypt(const std::vector<uint8_t> &ct)
+{
+    std::vector<uint8_t> bad_ct = ct;
+    bad_ct[bad_ct.size() - 1] ^= 0x12;
+    porc::timing_pool_options opts;
+    opts.workers = 4;
+    opts.pin = true;
+    porc::timing_pool pool(cbc_decrypt, porc::cipher_desc(iv, ct), porc::cipher_desc(iv, bad_ct), opts);
+
+    porc::decryptor p(iv, ct, porc::pkcs7_get_byte);
+    while (p.status() != porc::dec_status::DONE) {
+        size_t o = pool.find(p);
+        if (o == 0x100)
+            continue; // noise, measure again
+        p.step(o);
+        hexdump("pt: ", p.plaintext());
+    }
+    hexdump("plaintext: ", p.plaintext());
+    return p.plaintext().to_vector();
+}
+
+int main(void)
+{
+    for(auto &pt : { data_2blocks, data2_1block }) {
+        hexdump("plaintext:  ", pt);
+        auto ct = cbc_aes256_encrypt(iv, key, pt);
+        hexdump("ciphertext: ", ct);
+        auto pdec = decrypt(ct);
+        assert(std::equal(pt.begin(), pt.end(), pdec.begin()));
+    }
+}
@@ -0,0 +1,95 @@
+#include <cassert>
+#include <cstdio>
+#include <unistd.h>
+
+#include "porc/measure_log.hpp"
+#include "porc/stats.hpp"
+#include "common.hpp"
+
+/*
+    Timing based padding oracle, all raw measurements are logged.
+    Log is then replayed offline with different statistics,
+    without any oracle queries.
+*/
+
+void cbc_decrypt(const std::vector<uint8_t> &iv, const std::vector<uint8_t> &ct)
+{
+    if(cbc_aes256_decrypt(iv, key, ct).has_value())
+        usleep(20); // timing leak
+}
+
+std::vector<uint8_t> decrypt(const std::vector<uint8_t> &ct, porc::measure_log &log)
+{
+    const size_t tries = 10;
+    auto good = porc::stats::median(porc::time_ns(cbc_decrypt, iv, ct, tries));
+    std::vector<uint8_t> bad_ct = ct;
+    bad_ct[bad_ct.size() - 1] ^= 0x12;
+    auto bad = porc::stats::median(porc::time_ns(cbc_decrypt, iv, bad_ct, tries));
+    auto mid = (good + bad) / 2;
+
+    porc::decryptor p(iv, ct, porc::pkcs7_get_byte);
+    while (p.status() != porc::dec_status::DONE) {
+        auto o = std::find_if(p.begin(), p.end(), [&](porc::dec_option &opt) {
+            auto m = porc::time_ns(cbc_decrypt, opt.option, tries);
+            log.append(p, opt, m);
+            if (porc::stats::median(m) <= mid)
+                return false;
+            if (!opt.false_pos_check)
+                return true;
+            auto fp = porc::time_ns(cbc_decrypt, opt.false_pos_check.value(), tries);
+            log.append(p, opt, fp, true);
+            return porc::stats::median(fp) > mid;
+        });
+        p.step(o);
+    }
+    hexdump("plaintext: ", p.plaintext());
+    return p.plaintext().to_vector();
+}
+
+/*
+    No reference measurements offline: option with the slowest fastest run wins,
+    last byte option also needs slow false_pos_check
+*/
+size_t slowest(const std::vector<porc::logged_option> &opts)
+{
+    size_t res = 0x100;
+    int64_t best = 0;
+    for (auto &o : opts) {
+        auto m = *std::min_element(o.samples.begin(), o.samples.end());
+        if (!o.false_pos_samples.empty())
+            m = std::min(m, *std::min_element(o.false_pos_samples.begin(), o.false_pos_samples.end()));
+        if (m > best) {
+            best = m;
+            res = o.index;
+        }
+    }
+    return res;
+}
+
+int main(void)
+{
+    const char *path = "porc-timing.log";
+    remove(path);
+
+    hexdump("plaintext:  ", data2_1block);
+    auto ct = cbc_aes256_encrypt(iv, key, data2_1block);
+    hexdump("ciphertext: ", ct);
+    {
+        porc::measure_log log(path);
+        assert(log.ok());
+        auto pdec = decrypt(ct, log);
+        assert(std::equal(data2_1block.begin(), data2_1block.end(), pdec.begin()));
+    }
+
+    auto records = porc::measure_log::read(path);
+    assert(records);
+    printf("logged inputs: %zu\n", records->size());
+
+    porc::decryptor p(iv, ct, porc::pkcs7_get_byte);
+    size_t steps = porc::replay(records.value(), p, slowest);
+    printf("replayed steps: %zu\n", steps);
+    hexdump("replayed plaintext: ", p.plaintext());
+    assert(p.status() == porc::dec_status::DONE);
+    assert(std::equal(data2_1block.begin(), data2_1block.end(), p.plaintext().begin()));
+    remove(path);
+}
@@ -1,5 +1,6 @@
 #include <cassert>
 #include <chrono>
+#include <cmath>
 #include <cstdio>
 #include <unistd.h>
 
@@ -16,7 +17,7 @@ void cbc_decrypt(const std::vector<uint8_t> &iv, const std::vector<uint8_t> &ct)
         usleep(0); // timing leak
 }
 
-std::deque<uint8_t> decrypt(const std::vector<uint8_t> &ct)
+std::vector<uint8_t> decrypt(const std::vector<uint8_t> &ct)
 {
     const size_t tries = 10;
     auto good = porc::stats::mean(porc::time_ns(cbc_decrypt, iv, ct, tries));
@@ -25,8 +26,8 @@ std::deque<uint8_t> decrypt(const std::vector<uint8_t> &ct)
     auto bad = porc::stats::mean(porc::time_ns(cbc_decrypt, iv, bad_ct, tries));
     auto mid = (good + bad) / 2;
 
-    printf("good: %" PRIuMAX " bad: %" PRIuMAX " diff: %" PRIuMAX "\n",
-           bad, good, std::max(good, bad) - std::min(good, bad));
+    printf("good: %.0Lf bad: %.0Lf diff: %.0Lf\n",
+           good, bad, std::fabs(good - bad));
 
     porc::decryptor p(iv, ct, porc::pkcs7_get_byte);
     while (p.status() != porc::dec_status::DONE) {
@@ -37,7 +38,7 @@ std::deque<uint8_t> decrypt(const std::vector<uint8_t> &ct)
         hexdump("pt: ", p.plaintext());
     }
     hexdump("plaintext: ", p.plaintext());
-    return p.plaintext();
+    return p.plaintext().to_vector();
 }
 
 int main(void)
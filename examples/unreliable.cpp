@@ -3,7 +3,7 @@
 #include <unistd.h>
 #include <execution>
 
-#include "porc/porc.hpp"
+#include "porc/memo.hpp"
 #include "porc/stats.hpp"
 #include "common.hpp"
 
@@ -12,6 +12,8 @@
     Result of is_padded is mostly correct.
     Help the situation by using some knowledge of plaintext.
     Attacker knows bytes 0 and 10 of plaintext.
+    Good padding answers are double-checked, answers are remembered
+    so search branches don't ask the same thing again.
 */
 
 bool is_padded(const porc::cipher_desc &opt)
@@ -22,7 +24,9 @@ bool is_padded(const porc::cipher_desc &opt)
         return rand() % 100 == 0; // return "mostly false"
 }
 
-bool can_be_pkcs7_padded(const std::deque<uint8_t> &d)
+porc::memo_oracle oracle(is_padded, 0, porc::memo_policy { 1, 3, 0, 3 });
+
+bool can_be_pkcs7_padded(porc::byte_span d)
 {
     uint8_t padval = d[d.size() - 1];
     auto begin = padval >= d.size() ? d.begin() : d.end() - padval;
@@ -30,7 +34,7 @@ bool can_be_pkcs7_padded(const std::deque<uint8_t> &d)
 }
 
 
-bool can_be_good_pt(const std::deque<uint8_t> &d)
+bool can_be_good_pt(porc::byte_span d)
 {
     if(!can_be_pkcs7_padded(d))
         return false;
@@ -44,17 +48,17 @@ bool can_be_good_pt(const std::deque<uint8_t> &d)
     return true;
 }
 
-void decrypt_rec(const porc::decrypt &p, std::vector<std::deque<uint8_t>> &res)
+void decrypt_rec(const porc::decryptor &p, std::vector<std::vector<uint8_t>> &res)
 {
     for(auto v : p) {
-        if (porc::check_opt(is_padded, v)) {
+        if (porc::check_opt(oracle, v)) {
             porc::decryptor ptmp = p;
             ptmp.step(v.index);
 
             if(can_be_good_pt(ptmp.plaintext()))
             {
                 if(ptmp.status() == porc::dec_status::DONE) {
-                    res.push_back(ptmp.plaintext());
+                    res.push_back(ptmp.plaintext().to_vector());
                 } else {
                     decrypt_rec(ptmp, res);
                 }
@@ -63,12 +67,12 @@ void decrypt_rec(const porc::decrypt &p, std::vector<std::deque<uint8_t>> &res)
     }
 }
 
-std::vector<std::deque<uint8_t>> decrypt(const std::vector<uint8_t> &ct)
+std::vector<std::vector<uint8_t>> decrypt(const std::vector<uint8_t> &ct)
 {
     porc::decryptor p(iv, ct, porc::pkcs7_get_byte);
     for(auto v : p)
         assert(v.index < 0x100);
-    std::vector<std::deque<uint8_t>> res;
+    std::vector<std::vector<uint8_t>> res;
     decrypt_rec(p, res);
     assert(!res.empty());
     return res;
@@ -86,5 +90,6 @@ int main(void)
         hexdump(e ? ">>> " : "    ", i);
         has_correct_pt |= e;
     }
+    printf("oracle queries: %zu answered from memory: %zu\n", oracle.queries(), oracle.hits());
     assert(has_correct_pt);
 }
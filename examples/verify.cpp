@@ -0,0 +1,69 @@
+#include <cassert>
+#include <cstdio>
+#include <random>
+
+#include "porc/porc.hpp"
+#include "common.hpp"
+
+/*
+    Padding oracle that sometimes says bad padding is good.
+    Options are checked twice, chosen one once more to get confidence of a byte.
+    Wrong bytes that get through are caught by block verification
+    and decryption goes back to the least certain byte instead of starting over.
+*/
+
+std::mt19937 rng(1);
+size_t queries = 0;
+
+bool is_padded(porc::cipher_desc &opt)
+{
+    ++queries;
+    if(cbc_aes256_decrypt(opt.iv, key, opt.ciphertext).has_value())
+        return true;
+    else
+        return rng() % 50 == 0; // false positives
+}
+
+std::vector<uint8_t> decrypt(const std::vector<uint8_t> &ct)
+{
+    porc::decryptor p(iv, ct, porc::pkcs7_get_byte, nullptr, true);
+    size_t rewinds = 0;
+    queries = 0;
+    while (p.status() != porc::dec_status::DONE) {
+        if (p.status() == porc::dec_status::VERIFY) {
+            auto v = p.verification();
+            bool good = true;
+            for (size_t i = 0; good && i < 5; ++i)
+                good = is_padded(v);
+            rewinds += !good;
+            p.verified(good);
+            continue;
+        }
+
+        auto o = std::find_if(p.begin(), p.end(), [](porc::dec_option &opt) {
+            return porc::check_opt(is_padded, opt) && porc::check_opt(is_padded, opt);
+        });
+        if (o == p.end()) {
+            // a byte before is wrong, nothing can be good here:
+            // fill the block without blaming these bytes and let verification go back
+            p.step(p.begin(), 1);
+            continue;
+        }
+        p.step(o, porc::check_opt(is_padded, *o) ? 1 : 0.5);
+        hexdump("pt: ", p.plaintext());
+    }
+    printf("oracle queries: %zu, failed verifications: %zu\n", queries, rewinds);
+    hexdump("plaintext: ", p.plaintext());
+    return p.plaintext().to_vector();
+}
+
+int main(void)
+{
+    for(auto &pt : { data_2blocks, data2_1block }) {
+        hexdump("plaintext:  ", pt);
+        auto ct = cbc_aes256_encrypt(iv, key, pt);
+        hexdump("ciphertext: ", ct);
+        auto pdec = decrypt(ct);
+        assert(std::equal(pt.begin(), pt.end(), pdec.begin()));
+    }
+}
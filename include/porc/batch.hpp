@@ -0,0 +1,77 @@
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "porc/porc.hpp"
+
+#pragma once
+
+namespace porc {
+
+struct batch_options {
+    // worker threads, each one has at most one oracle query in flight
+    size_t workers = std::max(1u, std::thread::hardware_concurrency());
+    // stop after this many oracle queries in total
+    size_t max_queries = std::numeric_limits<size_t>::max();
+};
+
+/*
+    Decrypt many ciphertexts against the same oracle.
+    Identical ciphertext blocks are attacked only once,
+    unique blocks are decrypted by a pool of workers sharing a query budget.
+    Plaintexts are reported as soon as all of their blocks are known.
+*/
+class batch_decryptor {
+    std::function<uint8_t(size_t, size_t)> _get_padding_byte;
+    std::shared_ptr<intermediate_cache> _cache;
+    std::vector<cipher_desc> _inputs;
+    std::atomic<size_t> _queries = 0;
+
+    public:
+        /*
+            cache is used to look up blocks that are already known
+            and receives all decrypted blocks. Batch makes its own if not set.
+        */
+        batch_decryptor(
+            std::function<uint8_t(size_t, size_t)> get_padding_byte,
+            std::shared_ptr<intermediate_cache> cache = nullptr
+        );
+
+        /*
+            Add a ciphertext to decrypt, returns its id for run() callback
+        */
+        size_t add(const std::vector<uint8_t> &iv, const std::vector<uint8_t> &ciphertext);
+
+        /*
+            Decrypt everything that was added.
+            on_done(id, plaintext) is called for every decrypted ciphertext,
+            one call at a time, in order of completion.
+            Returns the number of decrypted ciphertexts,
+            it is less than number of added ones if query budget ran out
+            or no option had good padding for some block.
+        */
+        size_t run(
+            std::function<bool(cipher_desc&)> is_padded,
+            std::function<void(size_t, const std::vector<uint8_t>&)> on_done,
+            const batch_options &opts = batch_options()
+        );
+
+        /*
+            Oracle queries made by run() so far
+        */
+        size_t queries() const
+        {
+            return this->_queries;
+        }
+
+        std::shared_ptr<intermediate_cache> cache() const
+        {
+            return this->_cache;
+        }
+};
+
+}
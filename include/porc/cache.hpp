@@ -0,0 +1,50 @@
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+#pragma once
+
+namespace porc {
+
+/*
+    Block cipher intermediate values D_k(C) keyed by ciphertext block C.
+    Intermediate of a block doesn't depend on IV or neighbouring blocks,
+    so it can be reused by every decryptor that meets the same block again.
+    Safe to share between threads.
+*/
+class intermediate_cache {
+    mutable std::mutex _mutex;
+    std::map<std::vector<uint8_t>, std::vector<uint8_t>> _blocks;
+
+    public:
+        intermediate_cache() = default;
+
+        /*
+            Intermediate value for a block, if known
+        */
+        std::optional<std::vector<uint8_t>> get(const std::vector<uint8_t> &block) const;
+
+        /*
+            Remember intermediate value for a block
+        */
+        void put(const std::vector<uint8_t> &block, const std::vector<uint8_t> &intermediate);
+
+        size_t size() const;
+
+        /*
+            Write all known blocks to a file. Returns false on I/O error.
+        */
+        bool save(const std::string &path) const;
+
+        /*
+            Add blocks from a file written by save().
+            Returns false on I/O error or malformed file,
+            blocks read before the error are kept.
+        */
+        bool load(const std::string &path);
+};
+
+}
@@ -0,0 +1,82 @@
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "porc/porc.hpp"
+
+#pragma once
+
+namespace porc {
+
+enum class encoding {
+    HEX,
+    BASE64,
+    // URL and filename safe alphabet, '-' and '_' instead of '+' and '/'
+    BASE64URL
+};
+
+/*
+    Text encoding of iv || ciphertext for oracles that take hex / base64.
+    Output goes to a string owned by the caller and reused between calls.
+    Consecutive oracle inputs differ in a byte or two,
+    so only the part of the output that covers changed bytes is encoded again.
+    Base64 uses SSSE3 when the CPU has it.
+    Not thread-safe, use one encoder per thread.
+*/
+class encoder {
+    encoding _encoding;
+    bool _padding;
+    std::vector<uint8_t> _input;
+    const std::string *_out = nullptr;
+
+    void encode_range(std::string &out, size_t from, size_t to) const;
+
+    public:
+        /*
+            padding is '=' at the end of base64, ignored for hex
+        */
+        explicit encoder(encoding e, bool padding = true);
+
+        /*
+            Encoded size of n bytes
+        */
+        size_t encoded_size(size_t n) const;
+
+        /*
+            Encode d.iv || d.ciphertext to out.
+            Encoding is incremental if out is the string of the previous call
+            and wasn't changed since, otherwise out is encoded from scratch.
+        */
+        const std::string & encode(const cipher_desc &d, std::string &out);
+
+        /*
+            Forget previous input, next encode() starts from scratch
+        */
+        void reset();
+};
+
+/*
+    Oracle wrapper for f that takes encoded iv || ciphertext.
+    Copies share the encoder and output buffer, so it can be passed
+    to check_opt_f and friends as is. Not thread-safe.
+*/
+class encoded_oracle {
+    struct state {
+        encoder enc;
+        std::string out;
+
+        explicit state(encoder enc) : enc(std::move(enc)) { }
+    };
+
+    std::function<bool(const std::string&)> _f;
+    std::shared_ptr<state> _state;
+
+    public:
+        encoded_oracle(encoding e, std::function<bool(const std::string&)> f, bool padding = true);
+
+        bool operator()(cipher_desc &d);
+};
+
+}
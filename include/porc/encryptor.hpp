@@ -0,0 +1,142 @@
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "porc/porc.hpp"
+
+#pragma once
+
+namespace porc {
+
+/*
+    Forge ciphertext for a chosen plaintext with a padding oracle (CBC-R).
+    Ciphertext is built from the last block backwards:
+    intermediate of block C_i is recovered the same way decryptor does it,
+    then C_(i-1) = intermediate ^ P_i. Each block depends on the next one,
+    so blocks of one ciphertext are forged one at a time,
+    use separate encryptors to forge several ciphertexts concurrently.
+    Options and steps work the same way as in decryptor.
+*/
+class encryptor {
+    std::vector<uint8_t> _plaintext;
+    std::vector<uint8_t> _result;
+    size_t _block_size;
+    size_t _current_block;
+    std::function<uint8_t(size_t, size_t)> _get_padding_byte;
+    std::shared_ptr<intermediate_cache> _cache;
+    decryptor _block;
+
+    dec_status _status = dec_status::NONE;
+
+    void next_block();
+
+    public:
+        /*
+            plaintext is padded with get_padding_byte.
+            last_block is the last block of resulting ciphertext,
+            any value works and its size sets block size.
+            If cache is set, known intermediates are taken from it
+            and every recovered one is added to it.
+            Forging many plaintexts with common ending and the same last_block
+            recovers the common part only once.
+        */
+        encryptor(
+            const std::vector<uint8_t> &plaintext,
+            const std::vector<uint8_t> &last_block,
+            std::function<uint8_t(size_t, size_t)> get_padding_byte,
+            std::shared_ptr<intermediate_cache> cache = nullptr
+        );
+
+        /*
+            Get encryption status.
+            Keep calling step() with correct option until status becomes DONE.
+            NEW_BLOCK means that one more block was forged.
+        */
+        dec_status status() const
+        {
+            return this->_status;
+        }
+
+        /*
+            Iterate over possible options for a padding oracle.
+            It is caller's responsibility to pick a good one.
+        */
+        decryptor::option_iterator begin() const
+        {
+            return this->_block.begin();
+        }
+
+        decryptor::option_iterator end() const
+        {
+            return this->_block.end();
+        }
+
+        dec_option option(uint8_t v) const
+        {
+            return this->_block.option(v);
+        }
+
+        size_t block_size() const
+        {
+            return this->_block_size;
+        }
+
+        /*
+            Index of byte in current block that is being recovered
+        */
+        size_t current_byte() const
+        {
+            return this->_block.current_byte();
+        }
+
+        /*
+            Number of ciphertext blocks to forge, IV is not counted
+        */
+        size_t block_count() const
+        {
+            return this->_plaintext.size() / this->_block_size;
+        }
+
+        /*
+            Number of ciphertext blocks that are already forged
+        */
+        size_t blocks_done() const
+        {
+            return this->block_count() - this->_current_block;
+        }
+
+        /*
+            Padded plaintext
+        */
+        const std::vector<uint8_t> & plaintext() const
+        {
+            return this->_plaintext;
+        }
+
+        /*
+            Forged IV, available when status is DONE
+        */
+        std::vector<uint8_t> iv() const;
+
+        /*
+            Forged ciphertext, available when status is DONE
+        */
+        std::vector<uint8_t> ciphertext() const;
+
+        /*
+            Choose an option with good padding and go to the next byte.
+        */
+        dec_status step(const decryptor::option_iterator &good_opt)
+        {
+            assert(good_opt != this->end());
+            return this->step(good_opt.index());
+        }
+
+        /*
+            Choose an option with good padding and go to the next byte.
+        */
+        dec_status step(size_t good_opt);
+};
+
+}
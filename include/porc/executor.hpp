@@ -0,0 +1,118 @@
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+
+#include "porc/porc.hpp"
+
+#pragma once
+
+namespace porc {
+
+/*
+    Oracle answer that also tells when the oracle can't keep up
+*/
+enum class oracle_reply {
+    BAD_PADDING,
+    GOOD_PADDING,
+    // oracle refused to answer because of load, ask again later
+    THROTTLED,
+    // no answer in time, ask again later
+    TIMEOUT
+};
+
+struct executor_options {
+    // worker threads, upper bound for queries in flight
+    size_t max_concurrency = 64;
+    size_t initial_concurrency = 1;
+    // concurrency limit grows by this much after a limit worth of answers
+    double increase = 1;
+    // limit is multiplied by this on THROTTLED / TIMEOUT or slow answer
+    double decrease = 0.5;
+    // answers slower than this count as congestion, zero to ignore latency
+    std::chrono::nanoseconds latency_target = std::chrono::nanoseconds::zero();
+    // pause after THROTTLED / TIMEOUT, doubles on each failure in a row
+    std::chrono::nanoseconds backoff = std::chrono::milliseconds(1);
+    std::chrono::nanoseconds max_backoff = std::chrono::seconds(1);
+};
+
+struct executor_stats {
+    // answered queries
+    size_t queries = 0;
+    // THROTTLED and TIMEOUT replies
+    size_t failures = 0;
+    // current concurrency limit
+    double limit = 0;
+    size_t max_in_flight = 0;
+    // time since the first query
+    std::chrono::nanoseconds elapsed = std::chrono::nanoseconds::zero();
+
+    /*
+        Answered queries per second
+    */
+    double throughput() const
+    {
+        return this->elapsed.count() ? this->queries * 1e9 / this->elapsed.count() : 0;
+    }
+};
+
+/*
+    Runs oracle queries in parallel, adapting number of queries in flight
+    with additive increase / multiplicative decrease:
+    limit grows while oracle answers in time and drops on THROTTLED, TIMEOUT
+    or latency above target. Failed queries are repeated after a back-off.
+    Safe to call from multiple threads if f is.
+*/
+class oracle_executor {
+    typedef std::chrono::steady_clock clock;
+
+    std::function<oracle_reply(cipher_desc&)> _f;
+    executor_options _opts;
+
+    mutable std::mutex _mutex;
+    std::condition_variable _cv;
+    double _limit;
+    size_t _in_flight = 0;
+    // limit decreases at most once per queries that were started before it
+    size_t _epoch = 0;
+    size_t _failures_in_row = 0;
+    clock::time_point _pause_until;
+    std::optional<clock::time_point> _start;
+    executor_stats _stats;
+
+    size_t acquire();
+    void release(oracle_reply r, size_t epoch, clock::duration latency);
+
+    public:
+        oracle_executor(
+            std::function<oracle_reply(cipher_desc&)> f,
+            executor_options opts = executor_options()
+        );
+
+        /*
+            Ask oracle until it answers, true for good padding.
+            Waits while concurrency limit is reached.
+        */
+        bool operator()(cipher_desc &d);
+
+        /*
+            Check options 0 .. UINT8_MAX from option(v) in parallel.
+            Returns index of the first good one or 0x100 if none is.
+        */
+        size_t find_option(std::function<dec_option(uint8_t)> option);
+
+        /*
+            Check options of a decryptor / encryptor in parallel.
+            Returns index of the first good one or 0x100 if none is.
+        */
+        template <typename T>
+        size_t find(const T &d)
+        {
+            return this->find_option([&d](uint8_t v) { return d.option(v); });
+        }
+
+        executor_stats stats() const;
+};
+
+}
@@ -0,0 +1,104 @@
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "porc/porc.hpp"
+
+#pragma once
+
+namespace porc {
+
+/*
+    Raw measurements of one oracle input
+*/
+struct log_record {
+    // decryptor::current_block() / current_byte() when measured
+    size_t block = 0;
+    size_t byte = 0;
+    // option index
+    size_t index = 0;
+    // measured input is option's false_pos_check
+    bool false_pos = false;
+    // last two blocks of the input
+    std::vector<uint8_t> window;
+    std::vector<int64_t> samples;
+};
+
+/*
+    Append-only binary log of measurements, to try other statistics later
+    without asking the oracle again.
+    File is memory-mapped, samples are stored as deltas in variable-length encoding.
+    Log that wasn't closed properly (crash, kill) is readable up to the last full record.
+    Safe to append from multiple threads.
+*/
+class measure_log {
+    std::mutex _mutex;
+    int _fd = -1;
+    uint8_t *_map = nullptr;
+    size_t _size = 0;
+    size_t _used = 0;
+
+    bool reserve(size_t n);
+
+    public:
+        /*
+            Open a log to append to, file is created if it doesn't exist
+        */
+        explicit measure_log(const std::string &path);
+
+        measure_log(const measure_log &) = delete;
+        measure_log & operator=(const measure_log &) = delete;
+
+        ~measure_log();
+
+        /*
+            false if file couldn't be opened or isn't a log
+        */
+        bool ok() const
+        {
+            return this->_map != nullptr;
+        }
+
+        /*
+            Returns false on I/O error
+        */
+        bool append(const log_record &r);
+
+        /*
+            Log measurements of option o (or its false_pos_check) of decryptor d
+        */
+        bool append(const decryptor &d, const dec_option &o, const std::vector<int64_t> &samples, bool false_pos = false);
+
+        /*
+            All records of a log, nullopt if file can't be read or isn't a log
+        */
+        static std::optional<std::vector<log_record>> read(const std::string &path);
+};
+
+/*
+    Everything logged for one option
+*/
+struct logged_option {
+    size_t index;
+    std::vector<int64_t> samples;
+    std::vector<int64_t> false_pos_samples;
+};
+
+/*
+    Repeat decryption from a log with different statistics.
+    For the current byte of d, choose gets all options that have measurements
+    with matching inputs and returns index of the good one or 0x100 to stop.
+    Replay stops when current byte has no measurements,
+    e.g. once choose picked something else than the logged run and inputs diverged.
+    Returns number of steps made.
+*/
+size_t replay(
+    const std::vector<log_record> &log,
+    decryptor &d,
+    std::function<size_t(const std::vector<logged_option>&)> choose
+);
+
+}
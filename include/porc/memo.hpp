@@ -0,0 +1,97 @@
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "porc/porc.hpp"
+
+#pragma once
+
+namespace porc {
+
+/*
+    When to trust answers that are already known for an input.
+    Defaults fit a reliable oracle: every input is asked once.
+*/
+struct memo_policy {
+    // answers needed before an input is decided
+    size_t min_queries = 1;
+    // answers needed once any of them was good padding,
+    // for oracles with false positives
+    size_t min_good_queries = 1;
+    // keep asking while majority answer has smaller share than this...
+    double agreement = 0;
+    // ...but no more than that many times
+    size_t max_queries = 1;
+};
+
+/*
+    Answers of an oracle for one input
+*/
+struct memo_votes {
+    size_t good = 0;
+    size_t bad = 0;
+
+    size_t count() const { return this->good + this->bad; }
+    bool padded() const { return this->good > this->bad; }
+};
+
+/*
+    Oracle wrapper that remembers answers and doesn't ask the same thing twice.
+    Only last window bytes of iv || ciphertext identify an input,
+    for a padding oracle that's two last blocks.
+    Answer is the majority of votes collected according to memo_policy.
+    Copies share memory, so it can be passed to check_opt_f and friends as is.
+    Safe to call from multiple threads if f is.
+*/
+class memo_oracle {
+    struct key_hash {
+        size_t operator()(const std::vector<uint8_t> &v) const;
+    };
+
+    struct state {
+        std::mutex mutex;
+        std::unordered_map<std::vector<uint8_t>, memo_votes, key_hash> votes;
+        size_t queries = 0;
+        size_t hits = 0;
+    };
+
+    std::function<bool(cipher_desc&)> _f;
+    size_t _window;
+    memo_policy _policy;
+    std::shared_ptr<state> _state;
+
+    std::vector<uint8_t> key(const cipher_desc &d) const;
+    bool decided(const memo_votes &v) const;
+
+    public:
+        /*
+            window == 0 means two blocks (block size is taken from IV)
+        */
+        memo_oracle(
+            std::function<bool(cipher_desc&)> f,
+            size_t window = 0,
+            memo_policy policy = memo_policy()
+        );
+
+        bool operator()(cipher_desc &d);
+
+        /*
+            Answers collected for an input so far
+        */
+        memo_votes votes(const cipher_desc &d) const;
+
+        /*
+            Calls to the wrapped oracle
+        */
+        size_t queries() const;
+
+        /*
+            Calls answered from memory only
+        */
+        size_t hits() const;
+};
+
+}
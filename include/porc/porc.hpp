@@ -1,13 +1,16 @@
 #include <algorithm>
+#include <bitset>
+#include <cassert>
 #include <cinttypes>
+#include <cmath>
 #include <cstdint>
 #include <cstdio>
-#include <deque>
 #include <functional>
 #include <iterator>
 #include <memory>
 #include <vector>
 
+#include "porc/cache.hpp"
 #include "porc/stats.hpp"
 
 #pragma once
@@ -19,10 +22,46 @@ namespace porc {
 */
 uint8_t pkcs7_get_byte(size_t pad_pos, size_t pad_len);
 
+/*
+    ISO/IEC 7816-4 padding (0x80 followed by zeros) for blocks of block_size
+*/
+std::function<uint8_t(size_t, size_t)> iso7816_get_byte_f(size_t block_size);
+
 enum class dec_status {
     NONE,
     DONE,
-    NEW_BLOCK
+    NEW_BLOCK,
+    // block is decrypted, check decryptor::verification() and call verified()
+    VERIFY
+};
+
+/*
+    Read-only view of contiguous bytes, C++17 has no std::span
+*/
+class byte_span {
+    const uint8_t *_data = nullptr;
+    size_t _size = 0;
+
+    public:
+        byte_span() = default;
+        byte_span(const uint8_t *data, size_t size) : _data(data), _size(size) { }
+
+        const uint8_t * data() const { return this->_data; }
+        size_t size() const { return this->_size; }
+        bool empty() const { return this->_size == 0; }
+        const uint8_t * begin() const { return this->_data; }
+        const uint8_t * end() const { return this->_data + this->_size; }
+
+        uint8_t operator[](size_t i) const
+        {
+            assert(i < this->_size);
+            return this->_data[i];
+        }
+
+        std::vector<uint8_t> to_vector() const
+        {
+            return std::vector<uint8_t>(this->begin(), this->end());
+        }
 };
 
 /*
@@ -37,10 +76,16 @@ struct cipher_desc {
         : iv(iv), ciphertext(ct) { }
 };
 
+/*
+    Last n bytes of d.iv || d.ciphertext, or all of them if there are less
+*/
+std::vector<uint8_t> tail_bytes(const cipher_desc &d, size_t n);
+
 /*
     Possible option for inputs to a pading oracle.
     option is the main input,
-    false_pos_check contains data that needs to be checked to avoid last byte false-positive
+    false_pos_check contains data that needs to be checked to avoid false-positive
+    (last byte of pkcs7, every byte but the first for ISO 7816-4)
     See check_opt / measure_opt.
 */
 struct dec_option {
@@ -112,26 +157,150 @@ std::vector<int64_t> time_ns(F f, const porc::cipher_desc &d, size_t n)
     return time_ns(f, d.iv, d.ciphertext, n);
 }
 
+/*
+    Measure execution time of f with candidate and reference inputs back-to-back, n pairs.
+    Order within a pair alternates, so any effect of one input on the next one
+    hits candidate and reference equally.
+    Result in nanoseconds, see stats::paired.
+*/
+template <typename F>
+stats::paired_samples time_paired_ns(F f, const porc::cipher_desc &candidate, const porc::cipher_desc &reference, size_t n)
+{
+    stats::paired_samples res;
+    res.diffs.reserve(n);
+    res.candidate_first.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+        bool candidate_first = i % 2 == 0;
+        auto &a = candidate_first ? candidate : reference;
+        auto &b = candidate_first ? reference : candidate;
+        auto t0 = std::chrono::high_resolution_clock::now();
+        f(a.iv, a.ciphertext);
+        auto t1 = std::chrono::high_resolution_clock::now();
+        f(b.iv, b.ciphertext);
+        auto t2 = std::chrono::high_resolution_clock::now();
+        int64_t ta = std::chrono::nanoseconds(t1 - t0).count();
+        int64_t tb = std::chrono::nanoseconds(t2 - t1).count();
+        res.diffs.push_back(candidate_first ? ta - tb : tb - ta);
+        res.candidate_first.push_back(candidate_first);
+    }
+    return res;
+}
+
+/*
+    Measure execution time of f(opt.iv, opt.ciphertext) for all options of d
+    (decryptor / encryptor), n-times each.
+    Measurements are interleaved: one of each option per round,
+    so slow changes of oracle timing affect all options the same way.
+    Result in nanoseconds, res[i] are measurements of option i.
+*/
+template <typename F, typename T>
+std::vector<std::vector<int64_t>> time_options_ns(F f, const T &d, size_t n)
+{
+    std::vector<dec_option> opts;
+    for (size_t v = 0; v < 0x100; ++v)
+        opts.push_back(d.option(v));
+
+    std::vector<std::vector<int64_t>> res(opts.size());
+    for (auto &r : res)
+        r.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+        for (size_t v = 0; v < opts.size(); ++v) {
+            auto start = std::chrono::high_resolution_clock::now();
+            f(opts[v].option.iv, opts[v].option.ciphertext);
+            auto end = std::chrono::high_resolution_clock::now();
+            res[v].push_back(std::chrono::nanoseconds(end - start).count());
+        }
+    }
+    return res;
+}
+
+/*
+    Timing attack without reference measurements:
+    measure all options of d n-times and pick the one that stands out (see stats::outliers).
+    Outliers with false_pos_check (last byte) are confirmed by measuring it,
+    good option stays an outlier in the same direction.
+    Returns option index or 0x100 if nothing stands out.
+*/
+template <typename F, typename T>
+size_t find_outlier_ns(F f, const T &d, size_t n, long double threshold = 5)
+{
+    auto samples = time_options_ns(f, d, n);
+    std::vector<long double> medians;
+    for (auto &s : samples)
+        medians.push_back(stats::median(s));
+
+    for (auto i : stats::outliers(samples, threshold)) {
+        auto o = d.option(i);
+        if (!o.false_pos_check)
+            return i;
+
+        auto m = medians;
+        m.push_back(stats::median(time_ns(f, o.false_pos_check.value(), n)));
+        auto z = stats::robust_z(m);
+        if (std::fabs(z.back()) > threshold && (z.back() > 0) == (z[i] > 0))
+            return i;
+    }
+    return 0x100;
+}
+
+/*
+    Measure f with inputs of known good and bad padding n-times each
+    and estimate how many measurements per option a timing attack needs
+    to pick a wrong option with byte_error_rate probability.
+    See stats::calibrate.
+*/
+template <typename F>
+stats::calibration calibrate_ns(
+    F f,
+    const porc::cipher_desc &good,
+    const porc::cipher_desc &bad,
+    size_t n,
+    long double byte_error_rate)
+{
+    auto g = time_ns(f, good, n);
+    auto b = time_ns(f, bad, n);
+    return stats::calibrate(g, b, byte_error_rate);
+}
+
 /*
     Main class to provide options for a padding oracle attack
 */
 class decryptor {
     cipher_desc _orig;
     cipher_desc _playground;
-    std::deque<uint8_t> _plaintext;
+    // filled from the end, known part starts at _plaintext_begin
+    std::vector<uint8_t> _plaintext;
+    size_t _plaintext_begin;
+    std::vector<uint8_t> _intermediate;
+    std::vector<double> _confidence;
+    // options known to be wrong, per byte of current block
+    std::vector<std::bitset<0x100>> _rejected;
+    bool _verify;
+    // plaintext given by set_known
+    std::vector<bool> _known_mask;
+    std::vector<uint8_t> _known;
     size_t _block_size;
     size_t _block_count;
     size_t _current_block;
     size_t _current_byte;
     std::function<uint8_t(size_t, size_t)> _get_padding_byte;
+    std::shared_ptr<intermediate_cache> _cache;
+    std::function<void(size_t, byte_span)> _on_block;
 
     dec_status _status = dec_status::NONE;
 
-    void apply_padding(
-        std::vector<uint8_t>::const_iterator pm,
-        std::vector<uint8_t>::iterator bi);
-    void update_plaintext(size_t good_opt);
-    void update_playground();
+    std::vector<uint8_t>::const_iterator prev_block(size_t block) const;
+    std::vector<uint8_t>::iterator modified_block(cipher_desc &d) const;
+    void set_padding(cipher_desc &d, size_t from, size_t pad_len) const;
+    void commit_byte(uint8_t intermediate, double confidence, bool verify);
+    void finish_block();
+    void skip_cached();
+    bool ambiguous_padding() const;
+    bool has_known(size_t block) const;
+    void skip_known();
+    // rewind to the least certain byte of the current block in [from, block size)
+    void go_back(size_t from);
+    size_t next_allowed(size_t ind) const;
 
     public:
 
@@ -142,7 +311,7 @@ class decryptor {
 
             public:
                 option_iterator(const decryptor *parent, size_t ind)
-                    : _ind(ind), _parent(parent), _opt(parent->option(this->_ind)) { }
+                    : _ind(parent->next_allowed(ind)), _parent(parent), _opt(parent->option(this->_ind)) { }
 
 
                 option_iterator(const option_iterator &a)
@@ -153,6 +322,8 @@ class decryptor {
                 option_iterator & operator +=(int i)
                 {
                     this->_ind += i;
+                    if (i > 0)
+                        this->_ind = this->_parent->next_allowed(this->_ind);
                     this->_opt = this->_parent->option(this->_ind);
                     return *this;
                 }
@@ -247,10 +418,18 @@ class decryptor {
                 }
         };
 
+        /*
+            If cache is set, blocks found in it are decrypted without options
+            and every decrypted block is added to it.
+            If verify_blocks is set, every block decrypted with options
+            ends in VERIFY status, see verification().
+        */
         decryptor(
             const std::vector<uint8_t> &iv,
             const std::vector<uint8_t> &ciphertext,
-            std::function<uint8_t(size_t, size_t)> get_padding_byte
+            std::function<uint8_t(size_t, size_t)> get_padding_byte,
+            std::shared_ptr<intermediate_cache> cache = nullptr,
+            bool verify_blocks = false
         );
 
         /*
@@ -265,6 +444,7 @@ class decryptor {
         /*
             Iterate over possible options for a padding oracle.
             It is caller's responsibility to pick a good one.
+            Moving forward skips rejected options.
         */
         option_iterator begin() const
         {
@@ -286,14 +466,134 @@ class decryptor {
             return this->_orig.ciphertext;
         }
 
+        size_t block_size() const
+        {
+            return this->_block_size;
+        }
+
+        size_t block_count() const
+        {
+            return this->_block_count;
+        }
+
+        /*
+            Blocks end in VERIFY status
+        */
+        bool verify_blocks() const
+        {
+            return this->_verify;
+        }
+
         /*
-            Part of plaintext that is currently known
+            Index of ciphertext block that is being decrypted.
+            Blocks are decrypted from the last one to the first one.
         */
-        const std::deque<uint8_t> & plaintext() const
+        size_t current_block() const
         {
-            return this->_plaintext;
+            return this->_current_block;
         }
 
+        /*
+            Index of byte in current block that is being decrypted.
+            Bytes are decrypted from the last one to the first one.
+        */
+        size_t current_byte() const
+        {
+            return this->_current_byte;
+        }
+
+        /*
+            Ciphertext block with index i
+        */
+        std::vector<uint8_t> ciphertext_block(size_t i) const;
+
+        /*
+            Intermediate value D_k(C_i) of a fully decrypted ciphertext block,
+            plaintext block is intermediate ^ previous ciphertext block (or IV).
+        */
+        std::vector<uint8_t> intermediate(size_t block) const;
+
+        /*
+            Plaintext bytes at offset are known (fixed headers, JSON keys, padding),
+            their intermediates are derived without options.
+            Blocks with known bytes end in VERIFY status, one query checks the guess.
+            Known bytes have confidence 0, so if it fails, decryption goes back
+            to the first of them and all known bytes of the block are searched for.
+        */
+        void set_known(size_t offset, const std::vector<uint8_t> &bytes);
+
+        /*
+            Byte is taken from set_known instead of being searched
+        */
+        bool known(size_t block, size_t byte) const
+        {
+            assert(block < this->_block_count && byte < this->_block_size);
+            return this->_known_mask[block * this->_block_size + byte];
+        }
+
+        /*
+            Confidence passed to step() for a byte, 1 for bytes from cache, 0 for known ones
+        */
+        double confidence(size_t block, size_t byte) const
+        {
+            assert(block < this->_block_count && byte < this->_block_size);
+            return this->_confidence[block * this->_block_size + byte];
+        }
+
+        /*
+            Option v was chosen for current byte before and the block failed verification
+        */
+        bool rejected(uint8_t v) const
+        {
+            return this->_rejected[this->_current_byte][v];
+        }
+
+        /*
+            In VERIFY status: input with the whole current block as padding,
+            it has good padding only if all intermediate bytes of the block are right.
+            It's the input of the option chosen for byte 0 with a different IV,
+            so memoized or deterministic answers don't just repeat.
+            Messages of a single block leave nothing to change
+            (and oracles that don't send IV ignore it), there it is the same input.
+        */
+        cipher_desc verification() const;
+
+        /*
+            Result of checking verification().
+            Good block is committed (cache, next block),
+            otherwise decryption goes back to the byte of the block with the lowest confidence
+            and the option chosen for it is rejected (see set_known for known bytes).
+            Bytes of the block that are kept lose half of their confidence,
+            so repeated failures go back further.
+        */
+        dec_status verified(bool good);
+
+        /*
+            No option of the current byte has good padding, so a byte after it
+            in the block is wrong (a known one, or a false positive).
+            Decryption goes back the same way as when verification fails.
+            Returns false if the current byte is the last one of its block.
+        */
+        bool no_good_option();
+
+        /*
+            Part of plaintext that is currently known, the end of it.
+            View is valid until the next call that changes the decryptor.
+        */
+        byte_span plaintext() const
+        {
+            return byte_span(this->_plaintext.data() + this->_plaintext_begin,
+                             this->_plaintext.size() - this->_plaintext_begin);
+        }
+
+        /*
+            f(block, plaintext) is called for every block once it's decrypted
+            (and verified, see verify_blocks), blocks go from the last one to the first one.
+            Blocks finished before, e.g. taken from cache by the constructor,
+            are passed to f right away.
+        */
+        void on_block(std::function<void(size_t, byte_span)> f);
+
         /*
             Get possible option for a padding oracle.
             Iterate [0 .. UINT8_MAX] to get all of them
@@ -303,16 +603,18 @@ class decryptor {
 
         /*
             Choose an option with good padding and go to decryption of the next byte.
+            confidence in [0, 1] is how sure the caller is about good_opt,
+            it picks the byte to go back to when verification fails.
         */
-        dec_status step(const option_iterator &good_opt) {
+        dec_status step(const option_iterator &good_opt, double confidence = 1) {
             assert(good_opt != this->end());
-            return this->step(good_opt.index());
+            return this->step(good_opt.index(), confidence);
         }
 
         /*
             Choose an option with good padding and go to decryption of the next byte.
         */
-        dec_status step(size_t good_opt);
+        dec_status step(size_t good_opt, double confidence = 1);
 
 };
 
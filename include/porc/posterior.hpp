@@ -0,0 +1,154 @@
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <numeric>
+#include <optional>
+#include <vector>
+
+#include "porc/porc.hpp"
+#include "porc/stats.hpp"
+
+#pragma once
+
+namespace porc {
+
+/*
+    What one query of an input says about its padding
+*/
+struct evidence {
+    // log(P(answer | good padding) / P(answer | bad padding)) of a new answer for the input
+    std::function<double(cipher_desc&)> log_ratio;
+    // error rates of a yes / no oracle that is just as informative, to pick the next query
+    double false_positive = 0.01;
+    double false_negative = 0.01;
+};
+
+/*
+    Yes / no oracle that reports bad padding as good with probability false_positive
+    and good padding as bad with false_negative, both in (0, 0.5)
+*/
+evidence bool_evidence(std::function<bool(cipher_desc&)> f, double false_positive, double false_negative);
+
+/*
+    Median of samples measurements of f(iv, ciphertext),
+    normal around calibrated good / bad means (see calibrate_ns).
+    Its variance is taken as pi / 2 * sd^2 / samples, the asymptotic one of a median,
+    which is above the exact one for small samples.
+    Share of outliers (preemption, cache misses) can look like anything,
+    one query is never surer than that.
+*/
+template <typename F>
+evidence timing_evidence(F f, const stats::calibration &c, size_t samples, double outliers = 0.01)
+{
+    assert(samples > 0 && c.sd > 0);
+    assert(outliers > 0 && outliers < 0.5);
+    long double var = M_PI / 2 * c.sd * c.sd / samples;
+    long double good = c.good_mean;
+    long double bad = c.bad_mean;
+    double limit = std::log((1 - outliers) / outliers);
+
+    evidence res;
+    res.log_ratio = [f, samples, var, good, bad, limit](cipher_desc &d) {
+        long double x = stats::median(time_ns(f, d, samples));
+        double r = ((x - bad) * (x - bad) - (x - good) * (x - good)) / (2 * var);
+        return std::clamp(r, -limit, limit);
+    };
+    // median is on the wrong side of the threshold
+    double err = stats::normal_cdf(-c.effect_size * std::sqrt(samples / (M_PI / 2)) / 2);
+    res.false_positive = res.false_negative = std::max(err, outliers);
+    return res;
+}
+
+/*
+    Posterior probabilities of the 256 options of a byte, uniform at first,
+    and of none of them being good (a byte before is wrong)
+*/
+class byte_posterior {
+    // unnormalized, -inf for excluded options
+    std::vector<double> _log;
+    double _none;
+
+    public:
+        explicit byte_posterior(double none_prior = 0);
+
+        /*
+            Option is known to be wrong (decryptor::rejected)
+        */
+        void exclude(uint8_t v);
+
+        /*
+            Update with log likelihood ratio of an answer for option v
+        */
+        void observe(uint8_t v, double log_ratio);
+
+        std::vector<double> probabilities() const;
+        double probability(uint8_t v) const;
+        double probability_none() const;
+
+        /*
+            Most probable option
+        */
+        uint8_t best() const;
+
+        /*
+            Entropy in nats
+        */
+        double entropy() const;
+
+        /*
+            Option whose answer is expected to lower the entropy the most
+            from a yes / no oracle with these error rates
+        */
+        uint8_t next(double false_positive, double false_negative) const;
+};
+
+struct posterior_options {
+    // byte is committed once its best option is this probable,
+    // VERIFY is decided when block is right or wrong with this probability
+    double threshold = 0.999;
+    // queries per byte or per VERIFY before giving up, 0 for no limit
+    size_t max_queries = 0;
+    // prior of no good option for a byte
+    double none = 0.01;
+};
+
+/*
+    Decrypts by keeping a posterior over options of the current byte,
+    querying the option with the largest expected information gain
+    and committing the best one with its probability as confidence (decryptor::confidence).
+    false_pos_check of an option is queried once the option reaches the threshold,
+    like VERIFY status: from even odds until the threshold either way.
+    Good adds to the option's odds, bad rules it out.
+    When no option is good, rest of the block is filled with confidence 1
+    for verification to find the wrong byte before (decryptor::verify_blocks).
+*/
+class posterior_runner {
+    evidence _e;
+    posterior_options _opts;
+    size_t _queries = 0;
+
+    double ask(cipher_desc &d);
+    // log odds of good padding of d, asked until they reach threshold either way,
+    // nullopt if max_queries counted from start run out first
+    std::optional<double> decide(cipher_desc &d, size_t start);
+    bool verify(decryptor &d);
+
+    public:
+        explicit posterior_runner(const evidence &e, const posterior_options &opts = posterior_options());
+
+        /*
+            Decrypt to the end.
+            Returns false if a byte or a VERIFY took more than max_queries
+            (d is left at it), or a byte has no good option and blocks aren't verified.
+        */
+        bool run(decryptor &d);
+
+        size_t queries() const
+        {
+            return this->_queries;
+        }
+};
+
+}
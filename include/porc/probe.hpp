@@ -0,0 +1,79 @@
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <vector>
+
+#include "porc/porc.hpp"
+
+#pragma once
+
+namespace porc {
+
+enum class padding_scheme {
+    PKCS7,
+    ISO7816
+};
+
+struct probe_options {
+    // candidates, ascending, each at least twice the previous one
+    std::vector<size_t> block_sizes = { 8, 16, 32 };
+    // every probe is asked this many times, answer is the majority
+    size_t repeats = 3;
+    // single block messages tried to find a fixed server-side IV, 0 skips the test.
+    // Messages of several blocks pad the same way with either IV placement,
+    // and a single block has good padding with probability about 1/256
+    // if there is a fixed IV, so it's missed with probability (255/256)^iv_queries:
+    // 5% for 770, 1% for 1180. Decryption doesn't depend on it,
+    // only whether the first block is the IV or plaintext out of reach
+    size_t iv_queries = 0;
+};
+
+/*
+    What probe() found out about a message and its oracle
+*/
+struct probe_result {
+    size_t block_size = 0;
+    padding_scheme padding = padding_scheme::PKCS7;
+    std::function<uint8_t(size_t, size_t)> get_padding_byte;
+    // padding length of the message
+    size_t padding_length = 0;
+    // first block of the message is the IV,
+    // otherwise server uses its own and plaintext of the first block can't be decrypted.
+    // nullopt if not tested (iv_queries)
+    std::optional<bool> iv_prepended;
+    // share of repeated answers that agreed with the majority
+    double reliability = 1;
+    size_t queries = 0;
+    // message split into the first block and the rest
+    cipher_desc input;
+
+    /*
+        Decryptor of input, blocks are verified if the oracle wasn't reliable.
+        Its plaintext starts at the second block of the message if the IV isn't prepended.
+    */
+    decryptor make_decryptor(std::shared_ptr<intermediate_cache> cache = nullptr) const;
+};
+
+/*
+    Find block size, padding scheme and IV placement of message
+    (ciphertext as the oracle takes it) with a few oracle queries:
+    - flipping bytes from the end finds where padding and the last block end,
+      binary search over 2 blocks of the largest candidate
+    - changing the last padding byte to pkcs7 / ISO 7816-4 length 1 tells the scheme,
+      padding of length 1 needs a search of the byte before (up to 512 queries)
+    - single block messages with good padding mean a fixed IV (iv_queries, off by default)
+    f must say the original message is padded well.
+    Returns nullopt if answers don't fit any candidate.
+*/
+std::optional<probe_result> probe(
+    const std::vector<uint8_t> &message,
+    std::function<bool(const std::vector<uint8_t>&)> f,
+    const probe_options &opts = probe_options()
+);
+
+/*
+    Oracle of iv || ciphertext for a decryptor from probe_result::make_decryptor
+*/
+std::function<bool(cipher_desc&)> message_oracle(std::function<bool(const std::vector<uint8_t>&)> f);
+
+}
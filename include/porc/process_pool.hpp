@@ -0,0 +1,84 @@
+#include <cstdint>
+#include <functional>
+#include <sys/types.h>
+#include <vector>
+
+#include "porc/porc.hpp"
+
+#pragma once
+
+namespace porc {
+
+/*
+    Runs an oracle in forked worker processes,
+    for oracles that can't be called from several threads
+    (global state, single-threaded client libraries, etc).
+    Each worker has its own copy of the process made at construction
+    and a ring buffer of inputs in shared memory.
+    Linux / POSIX only. Not copyable, not thread-safe.
+*/
+class process_pool {
+    std::function<bool(cipher_desc&)> _f;
+    size_t _max_input;
+    size_t _ring_size;
+    size_t _slot_size;
+
+    void *_shm = nullptr;
+    size_t _shm_size = 0;
+    std::vector<pid_t> _workers;
+    std::vector<bool> _alive;
+    std::vector<uint32_t> _sent;
+    std::vector<uint32_t> _received;
+
+    uint8_t * slot(size_t worker, uint32_t n) const;
+    void worker_loop(size_t worker);
+    bool has_room(size_t worker) const;
+    void submit(size_t worker, uint32_t index, const dec_option &opt);
+    void wait_result(uint32_t &index, bool &result);
+    void check_workers();
+
+    public:
+        /*
+            Fork oracle workers.
+            max_input is the largest iv.size() + ciphertext.size() the pool will get,
+            ring_size is the number of inputs each worker can have queued.
+        */
+        process_pool(
+            std::function<bool(cipher_desc&)> f,
+            size_t workers,
+            size_t max_input,
+            size_t ring_size = 4
+        );
+
+        process_pool(const process_pool &) = delete;
+        process_pool & operator=(const process_pool &) = delete;
+
+        /*
+            Stops and waits for workers
+        */
+        ~process_pool();
+
+        size_t workers() const
+        {
+            return this->_workers.size();
+        }
+
+        /*
+            Check options 0 .. UINT8_MAX from option(v) with check_opt in workers.
+            Returns index of the first good one or 0x100 if none is.
+            Inputs queued to a worker that died count as bad padding.
+        */
+        size_t find_option(std::function<dec_option(uint8_t)> option);
+
+        /*
+            Check options of a decryptor / encryptor in workers.
+            Returns index of the first good one or 0x100 if none is.
+        */
+        template <typename T>
+        size_t find(const T &d)
+        {
+            return this->find_option([&d](uint8_t v) { return d.option(v); });
+        }
+};
+
+}
@@ -0,0 +1,89 @@
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <set>
+
+#include "porc/porc.hpp"
+
+#pragma once
+
+namespace porc {
+
+/*
+    Oracle that answers with more than good / bad padding:
+    f returns a fingerprint of the response (status code, error message,
+    response size, etc), equal for responses of the same kind.
+    Fingerprint of bad padding is learned as the most common one,
+    almost every option has bad padding. Anything else is good padding.
+    Fingerprints of good padding are learned too, by padding length,
+    from options that can't be false positives or passed false_pos_check.
+    If they differ between lengths, e.g. response size depends on plaintext length,
+    options are told from false positives without false_pos_check queries.
+    Not thread-safe.
+*/
+class response_oracle {
+    std::function<uint64_t(cipher_desc&)> _f;
+    size_t _learn_queries;
+    std::map<uint64_t, size_t> _counts;
+    size_t _total = 0;
+    uint64_t _invalid = 0;
+    // fingerprints of good padding by its length
+    std::map<size_t, std::set<uint64_t>> _pad;
+    size_t _saved = 0;
+
+    uint64_t query(cipher_desc &d);
+    bool learning() const;
+    bool separated(size_t pad_len) const;
+    bool other_length(size_t pad_len, uint64_t r) const;
+    bool confirm(const dec_option &opt, uint64_t r, size_t pad_len);
+
+    public:
+        /*
+            Bad padding fingerprint is decided after learn_queries responses
+        */
+        explicit response_oracle(std::function<uint64_t(cipher_desc&)> f, size_t learn_queries = 16);
+
+        /*
+            Check options 0 .. UINT8_MAX from option(v),
+            pad_len is padding length of a good one (block size - current byte).
+            Returns index of the first good one or 0x100 if none is.
+        */
+        size_t find_option(std::function<dec_option(uint8_t)> option, size_t pad_len);
+
+        /*
+            Check options of a decryptor / encryptor.
+            Returns index of the first good one or 0x100 if none is.
+        */
+        template <typename T>
+        size_t find(const T &d)
+        {
+            return this->find_option([&d](uint8_t v) { return d.option(v); },
+                                     d.block_size() - d.current_byte());
+        }
+
+        /*
+            Fingerprint of bad padding, valid once learn_queries responses are in
+        */
+        uint64_t invalid() const
+        {
+            return this->_invalid;
+        }
+
+        /*
+            Calls to f
+        */
+        size_t queries() const
+        {
+            return this->_total;
+        }
+
+        /*
+            false_pos_check queries answered by fingerprints
+        */
+        size_t saved() const
+        {
+            return this->_saved;
+        }
+};
+
+}
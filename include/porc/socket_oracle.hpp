@@ -0,0 +1,154 @@
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "porc/encoder.hpp"
+#include "porc/porc.hpp"
+
+#pragma once
+
+namespace porc {
+
+struct socket_options {
+    // persistent connections to the oracle
+    size_t connections = 4;
+    // requests sent on a connection before its answers come back
+    size_t pipeline = 8;
+    // no answer for that long reconnects and sends requests again
+    std::chrono::milliseconds timeout = std::chrono::seconds(5);
+    // timeouts in a row (and connection closes without answers, per connection)
+    // before giving up, failed reconnect gives up at once
+    size_t max_retries = 3;
+};
+
+/*
+    Length of the first response in buf, 0 if it isn't complete yet
+*/
+typedef std::function<size_t(std::string_view buf)> response_framing;
+
+/*
+    Responses that end with '\n'
+*/
+size_t frame_line(std::string_view buf);
+
+/*
+    Request builder that puts encoded iv || ciphertext in place of placeholder in tmpl,
+    e.g. "GET /check?data={data} HTTP/1.1\r\nHost: target\r\n\r\n"
+*/
+std::function<void(const cipher_desc&, std::string&)> request_template(
+    const std::string &tmpl,
+    encoding e,
+    const std::string &placeholder = "{data}");
+
+/*
+    Oracle client for network services.
+    Keeps persistent connections and pipelines requests on them with epoll,
+    connections that fail or time out are reopened and their requests sent again.
+    Server has to answer requests of a connection in order.
+    Address is "host:port" for TCP or "unix:/path" for a Unix socket.
+    Linux only. Not copyable, not thread-safe.
+*/
+class socket_oracle {
+    struct task {
+        size_t id;
+        cipher_desc input;
+    };
+
+    struct connection {
+        int fd = -1;
+        std::string out;
+        std::string in;
+        std::deque<task> pending;
+        bool want_write = false;
+    };
+
+    std::string _address;
+    std::function<void(const cipher_desc&, std::string&)> _make_request;
+    response_framing _framing;
+    std::function<bool(std::string_view)> _is_padded;
+    socket_options _opts;
+
+    int _epoll = -1;
+    std::vector<connection> _conns;
+    size_t _in_flight = 0;
+    size_t _queries = 0;
+    size_t _reconnects = 0;
+    bool _ok = true;
+    std::string _request;
+
+    bool connect(size_t c);
+    void disconnect(size_t c);
+    bool reconnect(size_t c);
+    void submit(size_t c, task t);
+    bool flush(size_t c);
+    bool receive(size_t c, const std::function<void(size_t, bool)> &done);
+    bool pump(const std::function<bool(task&)> &next, const std::function<void(size_t, bool)> &done);
+
+    public:
+        /*
+            make_request(d, req) writes request for input d to req,
+            framing splits received data to responses,
+            is_padded(response) tells if it means good padding.
+        */
+        socket_oracle(
+            const std::string &address,
+            std::function<void(const cipher_desc&, std::string&)> make_request,
+            response_framing framing,
+            std::function<bool(std::string_view)> is_padded,
+            socket_options opts = socket_options()
+        );
+
+        socket_oracle(const socket_oracle &) = delete;
+        socket_oracle & operator=(const socket_oracle &) = delete;
+
+        ~socket_oracle();
+
+        /*
+            false once the server couldn't be reached
+        */
+        bool ok() const
+        {
+            return this->_ok;
+        }
+
+        /*
+            Single query, false on bad padding or connection failure
+        */
+        bool operator()(cipher_desc &d);
+
+        /*
+            Check options 0 .. UINT8_MAX from option(v) with check_opt semantics,
+            requests of many options are in flight at once.
+            Returns index of the first good one or 0x100 if none is (or on connection failure).
+        */
+        size_t find_option(std::function<dec_option(uint8_t)> option);
+
+        /*
+            Check options of a decryptor / encryptor.
+            Returns index of the first good one or 0x100 if none is.
+        */
+        template <typename T>
+        size_t find(const T &d)
+        {
+            return this->find_option([&d](uint8_t v) { return d.option(v); });
+        }
+
+        /*
+            Answered requests
+        */
+        size_t queries() const
+        {
+            return this->_queries;
+        }
+
+        size_t reconnects() const
+        {
+            return this->_reconnects;
+        }
+};
+
+}
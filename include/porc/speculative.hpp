@@ -0,0 +1,65 @@
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <optional>
+
+#include "porc/porc.hpp"
+
+#pragma once
+
+namespace porc {
+
+struct speculative_stats {
+    size_t queries = 0;
+    // queries for a byte made while the byte before was being confirmed
+    size_t speculative = 0;
+    // speculative queries thrown away because confirmation failed
+    size_t wasted = 0;
+};
+
+/*
+    Decrypts with queries for the next byte started before the current one is confirmed.
+    When an option looks good, its confirmation (false_pos_check, extra checks)
+    runs while another thread searches the next byte on a copy of the decryptor
+    that took the option. Failed confirmation throws the copy away.
+    The byte that ends a block is confirmed before it's taken,
+    so cache, on_block and verification only see confirmed blocks.
+    f is called from two threads at once.
+*/
+class speculative_runner {
+    std::function<bool(cipher_desc&)> _f;
+    size_t _confirmations;
+    std::atomic<size_t> _queries = 0;
+    speculative_stats _stats;
+
+    // search for a good looking option, resumable
+    struct scan {
+        size_t next = 0;
+        std::optional<size_t> found;
+        size_t queries = 0;
+    };
+
+    // confidence of bytes taken without false_pos_check or confirmations
+    static constexpr double unconfirmed_confidence = 0.5;
+
+    bool ask(cipher_desc &d);
+    void search(const decryptor &d, scan &s, const std::atomic<bool> *stop);
+    bool confirm(const dec_option &o);
+
+    public:
+        /*
+            Option is accepted after confirmations more good answers
+            and a good false_pos_check if the option has one.
+        */
+        explicit speculative_runner(std::function<bool(cipher_desc&)> f, size_t confirmations = 0);
+
+        /*
+            Decrypt to the end, VERIFY status is checked with f too.
+            Returns false if current byte of d has no good option.
+        */
+        bool run(decryptor &d);
+
+        speculative_stats stats() const;
+};
+
+}
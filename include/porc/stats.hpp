@@ -6,6 +6,7 @@
 #include <deque>
 #include <functional>
 #include <iterator>
+#include <limits>
 #include <optional>
 #include <vector>
 
@@ -13,12 +14,60 @@
 
 namespace porc::stats {
 
-uintmax_t mean(const std::vector<int64_t> &v);
+long double mean(const std::vector<int64_t> &v);
 
 uintmax_t median(const std::vector<int64_t> &v);
 
 uintmax_t median(std::vector<int64_t> &&v);
 
+/*
+    Robust estimators below work in linear time,
+    && overloads reuse the argument as scratch space,
+    so results of time_ns can be passed without a copy.
+*/
+
+/*
+    Mean of values left after dropping fraction of the smallest
+    and fraction of the largest ones, fraction in [0, 0.5)
+*/
+long double trimmed_mean(const std::vector<int64_t> &v, long double fraction);
+
+long double trimmed_mean(std::vector<int64_t> &&v, long double fraction);
+
+/*
+    Mean with fraction of the smallest and fraction of the largest values
+    replaced by the nearest value that is kept, fraction in [0, 0.5)
+*/
+long double winsorized_mean(const std::vector<int64_t> &v, long double fraction);
+
+long double winsorized_mean(std::vector<int64_t> &&v, long double fraction);
+
+/*
+    Value with p share of values below it, p in [0, 1].
+    Low percentiles converge fast for timings with scheduler noise,
+    that only ever makes measurements longer.
+*/
+int64_t percentile(const std::vector<int64_t> &v, long double p);
+
+int64_t percentile(std::vector<int64_t> &&v, long double p);
+
+/*
+    Median of minimums of consecutive groups of k values
+*/
+int64_t min_of_k(const std::vector<int64_t> &v, size_t k);
+
+/*
+    Median absolute deviation from median
+*/
+long double mad(const std::vector<int64_t> &v);
+
+long double mad(std::vector<int64_t> &&v);
+
+/*
+    Values within [Q1 - k * IQR, Q3 + k * IQR], in original order
+*/
+std::vector<int64_t> iqr_filter(const std::vector<int64_t> &v, long double k = 1.5);
+
 long double covariance(const std::vector<int64_t> a, const std::vector<int64_t> &b);
 
 long double standard_deviation(const std::vector<int64_t> &a);
@@ -27,6 +76,98 @@ long double standard_deviation(const std::vector<int64_t> &a, const std::vector<
 
 long double corrcoef(const std::vector<int64_t> &a, const std::vector<int64_t> &b);
 
+/*
+    Robust z-score of each value:
+    distance from median in units of median absolute deviation,
+    scaled to match standard deviation for normal distribution.
+    Zero MAD is replaced with the smallest nonzero absolute deviation.
+*/
+std::vector<long double> robust_z(const std::vector<long double> &v);
+
+/*
+    Options whose median measurement stands out from the rest,
+    by robust z-score of medians above threshold in either direction.
+    samples[i] are measurements of option i, result is sorted by |z| desc.
+    Padding oracle has one or two good options out of 256,
+    so they are the outliers, no reference measurements are necessary.
+*/
+std::vector<size_t> outliers(const std::vector<std::vector<int64_t>> &samples, long double threshold = 5);
+
+/*
+    Standard normal distribution function
+*/
+long double normal_cdf(long double x);
+
+/*
+    Inverse of normal_cdf, p in (0, 1)
+*/
+long double normal_quantile(long double p);
+
+/*
+    How many measurements per option are needed to tell
+    good padding from bad padding by comparing their mean to threshold.
+*/
+struct calibration {
+    long double good_mean = 0;
+    long double bad_mean = 0;
+    // pooled standard deviation of a single measurement
+    long double sd = 0;
+    // |good_mean - bad_mean| / sd
+    long double effect_size = 0;
+    // mean of good and bad, compare mean of an option to it
+    long double threshold = 0;
+    bool greater_good = false;
+    // measurements per option, SIZE_MAX if good and bad can't be told apart
+    // (or only with more than 10^12 measurements)
+    // (or only with more than 10^12 measurements)
+    size_t samples = 0;
+    // measurements per decrypted byte when options are checked until the good one
+    long double expected_queries = 0;
+    // time per decrypted byte, in the same units as measurements
+    long double expected_time = 0;
+};
+
+/*
+    Sample size for a target probability of picking a wrong option for a byte,
+    estimated from measurements of inputs with known good and bad padding.
+    Assumes normal distribution of mean of measurements,
+    use more samples if distribution of a single one has a long tail.
+*/
+calibration calibrate(
+    const std::vector<int64_t> &good,
+    const std::vector<int64_t> &bad,
+    long double byte_error_rate,
+    size_t options = 0x100);
+
+/*
+    Measurements of a candidate input paired with a reference input
+    measured right before or after it
+*/
+struct paired_samples {
+    // candidate time - reference time, one per pair
+    std::vector<int64_t> diffs;
+    // candidate was measured first in the pair
+    std::vector<bool> candidate_first;
+};
+
+/*
+    Statistics of paired differences, noise slower than a pair cancels out
+*/
+struct paired_summary {
+    long double mean = 0;
+    long double median = 0;
+    long double sd = 0;
+    // paired t statistic, mean / (sd / sqrt(n))
+    long double t = 0;
+    // share of pairs where candidate was slower
+    long double positive = 0;
+    // mean difference when candidate went first - when it went second,
+    // far from zero if measuring one input warms up / slows down the next one
+    long double order_bias = 0;
+};
+
+paired_summary paired(const paired_samples &p);
+
 /*
     Distribution of values to a set of N-buckets of equal size between min and max
     i.e. if value 11 is found 123 times and value 12 is found 45 times,
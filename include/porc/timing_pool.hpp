@@ -0,0 +1,100 @@
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "porc/porc.hpp"
+
+#pragma once
+
+namespace porc {
+
+struct timing_pool_options {
+    size_t workers = std::thread::hardware_concurrency();
+    // measurements of every input by every worker
+    size_t samples = 10;
+    // pin worker i to CPU i (modulo CPUs), Linux only
+    bool pin = false;
+    // options measured at once by find_option
+    size_t batch = 16;
+};
+
+/*
+    Timing measurements spread over worker threads.
+    Timings of different cores (frequency, cache, contention) aren't compared:
+    every worker measures known good / bad padding inputs together with candidates
+    and scores candidates against its own baselines,
+    0 is as slow as bad padding, 1 as good padding.
+    Score of a candidate is the median of worker scores.
+    Not thread-safe, f is called from all workers at once.
+*/
+class timing_pool {
+    typedef std::function<void(const std::vector<uint8_t>&, const std::vector<uint8_t>&)> timed_f;
+
+    timed_f _f;
+    cipher_desc _good;
+    cipher_desc _bad;
+    timing_pool_options _opts;
+
+    std::mutex _mutex;
+    std::condition_variable _cv;
+    std::vector<std::thread> _threads;
+    // inputs of the current job, results[worker][input]
+    const std::vector<cipher_desc> *_inputs = nullptr;
+    std::vector<std::vector<double>> _results;
+    size_t _job = 0;
+    size_t _done = 0;
+    bool _stop = false;
+
+    void worker_loop(size_t worker);
+    void measure(size_t worker);
+
+    public:
+        /*
+            f(iv, ciphertext) is timed, good and bad are inputs with known padding
+        */
+        timing_pool(timed_f f, const cipher_desc &good, const cipher_desc &bad,
+                    const timing_pool_options &opts = timing_pool_options());
+
+        timing_pool(const timing_pool &) = delete;
+        timing_pool & operator=(const timing_pool &) = delete;
+
+        ~timing_pool();
+
+        size_t workers() const
+        {
+            return this->_threads.size();
+        }
+
+        /*
+            Scores of inputs, measured by all workers at once.
+            NaN if no worker could tell good padding from bad.
+        */
+        std::vector<double> scores(const std::vector<cipher_desc> &inputs);
+
+        /*
+            Score is above 0.5
+        */
+        bool is_padded(const cipher_desc &d);
+
+        /*
+            Measure options 0 .. UINT8_MAX from option(v) in batches,
+            best option of a batch scoring above 0.5 wins if its false_pos_check does too.
+            Returns its index or 0x100 if none is good.
+        */
+        size_t find_option(std::function<dec_option(uint8_t)> option);
+
+        /*
+            Measure options of a decryptor / encryptor.
+            Returns index of the good one or 0x100 if none is.
+        */
+        template <typename T>
+        size_t find(const T &d)
+        {
+            return this->find_option([&d](uint8_t v) { return d.option(v); });
+        }
+};
+
+}
@@ -0,0 +1,143 @@
+#include <cassert>
+#include <map>
+#include <mutex>
+#include "porc/batch.hpp"
+
+namespace porc {
+
+namespace {
+
+/*
+    Unique ciphertext block and ids of inputs that contain it
+*/
+struct block_job {
+    std::vector<uint8_t> prev;
+    std::vector<uint8_t> block;
+    std::vector<size_t> inputs;
+};
+
+std::vector<uint8_t> block_at(const cipher_desc &d, size_t i)
+{
+    size_t bs = d.iv.size();
+    if (i == 0)
+        return d.iv;
+    return std::vector<uint8_t>(d.ciphertext.begin() + (i - 1) * bs,
+                                d.ciphertext.begin() + i * bs);
+}
+
+std::vector<uint8_t> cached_plaintext(const cipher_desc &d, const intermediate_cache &cache)
+{
+    size_t bs = d.iv.size();
+    std::vector<uint8_t> res;
+    res.reserve(d.ciphertext.size());
+    for (size_t i = 0; i < d.ciphertext.size() / bs; ++i) {
+        auto prev = block_at(d, i);
+        auto inter = cache.get(block_at(d, i + 1)).value();
+        for (size_t j = 0; j < bs; ++j)
+            res.push_back(prev[j] ^ inter[j]);
+    }
+    return res;
+}
+
+}
+
+batch_decryptor::batch_decryptor(
+    std::function<uint8_t(size_t, size_t)> get_padding_byte,
+    std::shared_ptr<intermediate_cache> cache
+) : _get_padding_byte(get_padding_byte),
+    _cache(cache ? cache : std::make_shared<intermediate_cache>())
+{
+}
+
+size_t batch_decryptor::add(const std::vector<uint8_t> &iv, const std::vector<uint8_t> &ciphertext)
+{
+    assert(!iv.empty() && !ciphertext.empty());
+    assert(ciphertext.size() % iv.size() == 0);
+    this->_inputs.emplace_back(iv, ciphertext);
+    return this->_inputs.size() - 1;
+}
+
+size_t batch_decryptor::run(
+    std::function<bool(cipher_desc&)> is_padded,
+    std::function<void(size_t, const std::vector<uint8_t>&)> on_done,
+    const batch_options &opts)
+{
+    std::vector<block_job> jobs;
+    std::map<std::vector<uint8_t>, size_t> job_index;
+    std::vector<size_t> missing(this->_inputs.size());
+
+    for (size_t id = 0; id < this->_inputs.size(); ++id) {
+        auto &in = this->_inputs[id];
+        for (size_t i = 0; i < in.ciphertext.size() / in.iv.size(); ++i) {
+            auto block = block_at(in, i + 1);
+            if (this->_cache->get(block))
+                continue;
+
+            auto [it, inserted] = job_index.emplace(block, jobs.size());
+            if (inserted)
+                jobs.push_back(block_job { block_at(in, i), block, {} });
+
+            auto &waiting = jobs[it->second].inputs;
+            if (waiting.empty() || waiting.back() != id) {
+                waiting.push_back(id);
+                ++missing[id];
+            }
+        }
+    }
+
+    std::mutex done_mutex;
+    size_t done = 0;
+    auto emit = [&](size_t id) {
+        on_done(id, cached_plaintext(this->_inputs[id], *this->_cache));
+        ++done;
+    };
+
+    for (size_t id = 0; id < this->_inputs.size(); ++id)
+        if (missing[id] == 0)
+            emit(id);
+
+    size_t budget_start = this->_queries;
+    std::atomic<bool> exhausted = false;
+    auto oracle = check_opt_f([&](cipher_desc &d) {
+        if (this->_queries++ - budget_start >= opts.max_queries) {
+            --this->_queries;
+            exhausted = true;
+            return false;
+        }
+        return is_padded(d);
+    });
+
+    std::atomic<size_t> next_job = 0;
+    auto work = [&]() {
+        size_t j;
+        while (!exhausted && (j = next_job++) < jobs.size()) {
+            auto &job = jobs[j];
+            decryptor p(job.prev, job.block, this->_get_padding_byte, this->_cache);
+            while (p.status() != dec_status::DONE && !exhausted) {
+                auto o = std::find_if(p.begin(), p.end(), oracle);
+                if (o == p.end())
+                    break;
+                p.step(o);
+            }
+
+            if (p.status() != dec_status::DONE)
+                continue;
+
+            std::lock_guard<std::mutex> lock(done_mutex);
+            for (auto id : job.inputs)
+                if (--missing[id] == 0)
+                    emit(id);
+        }
+    };
+
+    std::vector<std::thread> pool;
+    size_t workers = std::clamp<size_t>(opts.workers, 1, std::max<size_t>(1, jobs.size()));
+    for (size_t i = 0; i < workers; ++i)
+        pool.emplace_back(work);
+    for (auto &t : pool)
+        t.join();
+
+    return done;
+}
+
+}
@@ -0,0 +1,72 @@
+#include <cassert>
+#include <cstdio>
+#include <memory>
+#include "porc/cache.hpp"
+
+namespace porc {
+
+std::optional<std::vector<uint8_t>> intermediate_cache::get(const std::vector<uint8_t> &block) const
+{
+    std::lock_guard<std::mutex> lock(this->_mutex);
+    auto i = this->_blocks.find(block);
+    if (i == this->_blocks.end())
+        return std::nullopt;
+    return i->second;
+}
+
+void intermediate_cache::put(const std::vector<uint8_t> &block, const std::vector<uint8_t> &intermediate)
+{
+    assert(block.size() == intermediate.size());
+    std::lock_guard<std::mutex> lock(this->_mutex);
+    this->_blocks[block] = intermediate;
+}
+
+size_t intermediate_cache::size() const
+{
+    std::lock_guard<std::mutex> lock(this->_mutex);
+    return this->_blocks.size();
+}
+
+/*
+    File is a sequence of records:
+    uint32_t block size, block, intermediate
+*/
+bool intermediate_cache::save(const std::string &path) const
+{
+    std::unique_ptr<FILE, decltype(&::fclose)> f(fopen(path.c_str(), "wb"), fclose);
+    if (!f)
+        return false;
+
+    std::lock_guard<std::mutex> lock(this->_mutex);
+    for (auto &[block, inter] : this->_blocks) {
+        uint32_t size = block.size();
+        if (fwrite(&size, sizeof(size), 1, f.get()) != 1
+            || fwrite(block.data(), 1, size, f.get()) != size
+            || fwrite(inter.data(), 1, size, f.get()) != size)
+            return false;
+    }
+    return fflush(f.get()) == 0;
+}
+
+bool intermediate_cache::load(const std::string &path)
+{
+    std::unique_ptr<FILE, decltype(&::fclose)> f(fopen(path.c_str(), "rb"), fclose);
+    if (!f)
+        return false;
+
+    uint32_t size;
+    while (fread(&size, sizeof(size), 1, f.get()) == 1) {
+        if (size == 0 || size > 0x100)
+            return false;
+
+        std::vector<uint8_t> block(size), inter(size);
+        if (fread(block.data(), 1, size, f.get()) != size
+            || fread(inter.data(), 1, size, f.get()) != size)
+            return false;
+
+        this->put(block, inter);
+    }
+    return !ferror(f.get());
+}
+
+}
@@ -0,0 +1,191 @@
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include "porc/encoder.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define PORC_HAVE_SSSE3 1
+#endif
+
+namespace porc {
+
+namespace {
+
+const char hex_digits[] = "0123456789ABCDEF";
+const char base64_std[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+const char base64_url[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+/*
+    Encode full 3-byte groups, returns number of bytes encoded
+*/
+size_t base64_groups(const uint8_t *in, size_t n, char *out, bool url)
+{
+    const char *abc = url ? base64_url : base64_std;
+    size_t i = 0;
+    for (; i + 3 <= n; i += 3, out += 4) {
+        uint32_t v = (in[i] << 16) | (in[i + 1] << 8) | in[i + 2];
+        out[0] = abc[v >> 18];
+        out[1] = abc[(v >> 12) & 0x3f];
+        out[2] = abc[(v >> 6) & 0x3f];
+        out[3] = abc[v & 0x3f];
+    }
+    return i;
+}
+
+#ifdef PORC_HAVE_SSSE3
+
+/*
+    16 output characters from 12 input bytes per round (W. Mula, D. Lemire).
+    Reads 16 bytes per round, so the last 4 input bytes are left to the caller.
+*/
+__attribute__((target("ssse3")))
+size_t base64_groups_ssse3(const uint8_t *in, size_t n, char *out, bool url)
+{
+    const __m128i shuffle = _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1);
+    const __m128i shift = _mm_setr_epi8(
+        'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+        '0' - 52, '0' - 52, '0' - 52, (url ? '-' : '+') - 62, (url ? '_' : '/') - 63, 'A', 0, 0);
+
+    size_t i = 0;
+    for (; i + 16 <= n; i += 12, out += 16) {
+        __m128i v = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(in + i)), shuffle);
+
+        // split 3 bytes of each 32-bit lane to 4 6-bit indices
+        __m128i t0 = _mm_mulhi_epu16(_mm_and_si128(v, _mm_set1_epi32(0x0fc0fc00)), _mm_set1_epi32(0x04000040));
+        __m128i t1 = _mm_mullo_epi16(_mm_and_si128(v, _mm_set1_epi32(0x003f03f0)), _mm_set1_epi32(0x01000010));
+        __m128i idx = _mm_or_si128(t0, t1);
+
+        // 0..25 -> 13, 26..51 -> 0, 52..61 -> 1..10, 62 -> 11, 63 -> 12
+        __m128i r = _mm_subs_epu8(idx, _mm_set1_epi8(51));
+        r = _mm_or_si128(r, _mm_and_si128(_mm_cmpgt_epi8(_mm_set1_epi8(26), idx), _mm_set1_epi8(13)));
+        r = _mm_add_epi8(_mm_shuffle_epi8(shift, r), idx);
+        _mm_storeu_si128((__m128i*)out, r);
+    }
+    return i;
+}
+
+bool have_ssse3()
+{
+    static const bool res = (__builtin_cpu_init(), __builtin_cpu_supports("ssse3"));
+    return res;
+}
+
+#endif
+
+size_t base64_encode(const uint8_t *in, size_t n, char *out, bool url)
+{
+    size_t done = 0;
+#ifdef PORC_HAVE_SSSE3
+    if (have_ssse3())
+        done = base64_groups_ssse3(in, n, out, url);
+#endif
+    return done + base64_groups(in + done, n - done, out + done / 3 * 4, url);
+}
+
+}
+
+encoder::encoder(encoding e, bool padding) : _encoding(e), _padding(padding)
+{
+}
+
+size_t encoder::encoded_size(size_t n) const
+{
+    if (this->_encoding == encoding::HEX)
+        return 2 * n;
+    return this->_padding ? (n + 2) / 3 * 4 : (4 * n + 2) / 3;
+}
+
+void encoder::encode_range(std::string &out, size_t from, size_t to) const
+{
+    const uint8_t *in = this->_input.data();
+    if (this->_encoding == encoding::HEX) {
+        for (size_t i = from; i < to; ++i) {
+            out[2 * i] = hex_digits[in[i] >> 4];
+            out[2 * i + 1] = hex_digits[in[i] & 0xf];
+        }
+        return;
+    }
+
+    // whole groups of 3 bytes around the range
+    bool url = this->_encoding == encoding::BASE64URL;
+    size_t n = this->_input.size();
+    from = from / 3 * 3;
+    to = std::min(n, (to + 2) / 3 * 3);
+    size_t done = from + base64_encode(in + from, to - from, &out[from / 3 * 4], url);
+    if (done == to)
+        return;
+
+    // last partial group
+    const char *abc = url ? base64_url : base64_std;
+    uint32_t v = in[done] << 16;
+    if (n - done == 2)
+        v |= in[done + 1] << 8;
+    char tail[4] = { abc[v >> 18], abc[(v >> 12) & 0x3f], abc[(v >> 6) & 0x3f], '=' };
+    if (n - done == 1)
+        tail[2] = '=';
+    std::copy(tail, tail + out.size() - done / 3 * 4, &out[done / 3 * 4]);
+}
+
+const std::string & encoder::encode(const cipher_desc &d, std::string &out)
+{
+    size_t n = d.iv.size() + d.ciphertext.size();
+    bool full = this->_out != &out || this->_input.size() != n || out.size() != this->encoded_size(n);
+
+    size_t from = 0, to = n;
+    if (full) {
+        this->_input.resize(n);
+        std::copy(d.iv.begin(), d.iv.end(), this->_input.begin());
+        std::copy(d.ciphertext.begin(), d.ciphertext.end(), this->_input.begin() + d.iv.size());
+        out.resize(this->encoded_size(n));
+    } else {
+        // first and last changed byte, iv and ciphertext are compared separately
+        auto iv_end = this->_input.begin() + d.iv.size();
+        auto iv_diff = std::mismatch(d.iv.begin(), d.iv.end(), this->_input.begin());
+        if (iv_diff.first != d.iv.end()) {
+            from = iv_diff.second - this->_input.begin();
+        } else {
+            auto ct_diff = std::mismatch(d.ciphertext.begin(), d.ciphertext.end(), iv_end);
+            from = ct_diff.second - this->_input.begin();
+        }
+        if (from == n)
+            return out;
+
+        auto ct_rdiff = std::mismatch(d.ciphertext.rbegin(), d.ciphertext.rend(), this->_input.rbegin());
+        if (ct_rdiff.first != d.ciphertext.rend()) {
+            to = this->_input.rend() - ct_rdiff.second;
+        } else {
+            auto iv_rdiff = std::mismatch(d.iv.rbegin(), d.iv.rend(), ct_rdiff.second);
+            to = this->_input.rend() - iv_rdiff.second;
+        }
+
+        std::copy(d.iv.begin() + std::min(from, d.iv.size()), d.iv.begin() + std::min(to, d.iv.size()),
+                  this->_input.begin() + from);
+        if (to > d.iv.size()) {
+            size_t ct_from = std::max(from, d.iv.size()) - d.iv.size();
+            std::copy(d.ciphertext.begin() + ct_from, d.ciphertext.begin() + (to - d.iv.size()),
+                      iv_end + ct_from);
+        }
+    }
+
+    this->_out = &out;
+    this->encode_range(out, from, to);
+    return out;
+}
+
+void encoder::reset()
+{
+    this->_out = nullptr;
+}
+
+encoded_oracle::encoded_oracle(encoding e, std::function<bool(const std::string&)> f, bool padding)
+    : _f(f), _state(std::make_shared<state>(encoder(e, padding)))
+{
+}
+
+bool encoded_oracle::operator()(cipher_desc &d)
+{
+    return this->_f(this->_state->enc.encode(d, this->_state->out));
+}
+
+}
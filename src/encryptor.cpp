@@ -0,0 +1,87 @@
+#include <cassert>
+#include "porc/encryptor.hpp"
+
+namespace porc {
+
+namespace {
+
+std::vector<uint8_t> pad(
+    const std::vector<uint8_t> &plaintext,
+    size_t block_size,
+    std::function<uint8_t(size_t, size_t)> get_padding_byte)
+{
+    assert(block_size > 0);
+    std::vector<uint8_t> res = plaintext;
+    size_t pad_len = block_size - plaintext.size() % block_size;
+    for (size_t i = block_size - pad_len; i < block_size; ++i)
+        res.push_back(get_padding_byte(i, pad_len));
+    return res;
+}
+
+}
+
+encryptor::encryptor(
+    const std::vector<uint8_t> &plaintext,
+    const std::vector<uint8_t> &last_block,
+    std::function<uint8_t(size_t, size_t)> get_padding_byte,
+    std::shared_ptr<intermediate_cache> cache
+) : _plaintext(pad(plaintext, last_block.size(), get_padding_byte)),
+    _result(_plaintext.size() + last_block.size()),
+    _block_size(last_block.size()),
+    _current_block(_plaintext.size() / last_block.size()),
+    _get_padding_byte(get_padding_byte),
+    _cache(cache),
+    _block(std::vector<uint8_t>(last_block.size()), last_block, get_padding_byte, cache)
+{
+    std::copy(last_block.begin(), last_block.end(), this->_result.end() - this->_block_size);
+    if (this->_block.status() == dec_status::DONE)
+        this->next_block();
+}
+
+void encryptor::next_block()
+{
+    do {
+        auto inter = this->_block.intermediate(0);
+        auto prev = this->_result.begin() + (this->_current_block - 1) * this->_block_size;
+        auto pt = this->_plaintext.begin() + (this->_current_block - 1) * this->_block_size;
+        for (size_t i = 0; i < this->_block_size; ++i)
+            prev[i] = inter[i] ^ pt[i];
+
+        --this->_current_block;
+        if (this->_current_block == 0) {
+            this->_status = dec_status::DONE;
+            return;
+        }
+
+        this->_block = decryptor(std::vector<uint8_t>(this->_block_size),
+                                 std::vector<uint8_t>(prev, prev + this->_block_size),
+                                 this->_get_padding_byte,
+                                 this->_cache);
+    } while (this->_block.status() == dec_status::DONE);
+
+    this->_status = dec_status::NEW_BLOCK;
+}
+
+std::vector<uint8_t> encryptor::iv() const
+{
+    assert(this->_status == dec_status::DONE);
+    return std::vector<uint8_t>(this->_result.begin(), this->_result.begin() + this->_block_size);
+}
+
+std::vector<uint8_t> encryptor::ciphertext() const
+{
+    assert(this->_status == dec_status::DONE);
+    return std::vector<uint8_t>(this->_result.begin() + this->_block_size, this->_result.end());
+}
+
+dec_status encryptor::step(size_t good_opt)
+{
+    assert(this->_status != dec_status::DONE);
+    if (this->_block.step(good_opt) == dec_status::DONE)
+        this->next_block();
+    else
+        this->_status = dec_status::NONE;
+    return this->_status;
+}
+
+}
@@ -0,0 +1,124 @@
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <thread>
+#include "porc/executor.hpp"
+
+namespace porc {
+
+oracle_executor::oracle_executor(
+    std::function<oracle_reply(cipher_desc&)> f,
+    executor_options opts
+) : _f(f), _opts(opts)
+{
+    assert(opts.max_concurrency > 0);
+    assert(opts.decrease > 0 && opts.decrease < 1);
+    this->_limit = std::clamp<double>(opts.initial_concurrency, 1, opts.max_concurrency);
+    this->_stats.limit = this->_limit;
+}
+
+size_t oracle_executor::acquire()
+{
+    std::unique_lock<std::mutex> lock(this->_mutex);
+    for (;;) {
+        if (clock::now() < this->_pause_until)
+            this->_cv.wait_until(lock, this->_pause_until);
+        else if (this->_in_flight >= (size_t)this->_limit)
+            this->_cv.wait(lock);
+        else
+            break;
+    }
+
+    if (!this->_start)
+        this->_start = clock::now();
+    ++this->_in_flight;
+    this->_stats.max_in_flight = std::max(this->_stats.max_in_flight, this->_in_flight);
+    return this->_epoch;
+}
+
+void oracle_executor::release(oracle_reply r, size_t epoch, clock::duration latency)
+{
+    std::lock_guard<std::mutex> lock(this->_mutex);
+    --this->_in_flight;
+
+    bool failed = r == oracle_reply::THROTTLED || r == oracle_reply::TIMEOUT;
+    bool slow = this->_opts.latency_target.count() && latency > this->_opts.latency_target;
+    if (failed)
+        ++this->_stats.failures;
+    else
+        ++this->_stats.queries;
+
+    if (failed || slow) {
+        // queries in flight during the drop report the same congestion, ignore them
+        if (epoch == this->_epoch) {
+            this->_limit = std::max(1.0, this->_limit * this->_opts.decrease);
+            ++this->_epoch;
+        }
+        if (failed) {
+            auto pause = std::min<clock::duration>(
+                this->_opts.max_backoff,
+                this->_opts.backoff * (1ull << std::min<size_t>(this->_failures_in_row, 20)));
+            ++this->_failures_in_row;
+            this->_pause_until = std::max(this->_pause_until, clock::now() + pause);
+        }
+    } else {
+        this->_failures_in_row = 0;
+        this->_limit = std::min<double>(this->_opts.max_concurrency,
+                                        this->_limit + this->_opts.increase / this->_limit);
+    }
+    this->_stats.limit = this->_limit;
+    this->_cv.notify_all();
+}
+
+bool oracle_executor::operator()(cipher_desc &d)
+{
+    for (;;) {
+        size_t epoch = this->acquire();
+        auto start = clock::now();
+        auto r = this->_f(d);
+        this->release(r, epoch, clock::now() - start);
+
+        if (r == oracle_reply::GOOD_PADDING)
+            return true;
+        if (r == oracle_reply::BAD_PADDING)
+            return false;
+    }
+}
+
+size_t oracle_executor::find_option(std::function<dec_option(uint8_t)> option)
+{
+    std::atomic<size_t> next = 0;
+    std::atomic<size_t> found = 0x100;
+    auto check = [this](cipher_desc &d) { return (*this)(d); };
+
+    auto work = [&]() {
+        size_t i;
+        while ((i = next++) < found) {
+            auto o = option(i);
+            if (!check_opt(check, o))
+                continue;
+            size_t cur = found;
+            while (i < cur && !found.compare_exchange_weak(cur, i))
+                ;
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (size_t i = 0; i < std::min<size_t>(this->_opts.max_concurrency, 0x100); ++i)
+        pool.emplace_back(work);
+    for (auto &t : pool)
+        t.join();
+
+    return found;
+}
+
+executor_stats oracle_executor::stats() const
+{
+    std::lock_guard<std::mutex> lock(this->_mutex);
+    executor_stats res = this->_stats;
+    if (this->_start)
+        res.elapsed = clock::now() - this->_start.value();
+    return res;
+}
+
+}
@@ -0,0 +1,294 @@
+#include <cstring>
+#include <fcntl.h>
+#include <map>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "porc/measure_log.hpp"
+
+namespace porc {
+
+namespace {
+
+const uint8_t magic[8] = { 'P', 'O', 'R', 'C', 'L', 'O', 'G', '1' };
+const size_t min_map_size = 1 << 16;
+
+void put_varint(std::vector<uint8_t> &out, uint64_t v)
+{
+    while (v >= 0x80) {
+        out.push_back(v | 0x80);
+        v >>= 7;
+    }
+    out.push_back(v);
+}
+
+uint64_t zigzag(int64_t v)
+{
+    return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+int64_t unzigzag(uint64_t v)
+{
+    return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+class record_reader {
+    const uint8_t *_p;
+    const uint8_t *_end;
+    bool _ok = true;
+
+    public:
+        record_reader(const uint8_t *p, const uint8_t *end) : _p(p), _end(end) { }
+
+        bool ok() const { return this->_ok; }
+
+        uint64_t varint()
+        {
+            uint64_t r = 0;
+            for (size_t shift = 0; this->_p != this->_end && shift < 64; shift += 7) {
+                uint8_t b = *this->_p++;
+                r |= (uint64_t)(b & 0x7f) << shift;
+                if (!(b & 0x80))
+                    return r;
+            }
+            this->_ok = false;
+            return 0;
+        }
+
+        uint8_t byte()
+        {
+            if (this->_p == this->_end) {
+                this->_ok = false;
+                return 0;
+            }
+            return *this->_p++;
+        }
+
+        void bytes(std::vector<uint8_t> &out, size_t n)
+        {
+            if ((size_t)(this->_end - this->_p) < n) {
+                this->_ok = false;
+                return;
+            }
+            out.assign(this->_p, this->_p + n);
+            this->_p += n;
+        }
+};
+
+/*
+    Record is uint32_t payload length followed by payload:
+    varint block, varint byte, varint index, uint8_t flags,
+    varint window size, window, varint sample count, zigzag varint sample deltas.
+    Zero length marks the end of log.
+*/
+std::vector<uint8_t> encode(const log_record &r)
+{
+    std::vector<uint8_t> res(sizeof(uint32_t));
+    put_varint(res, r.block);
+    put_varint(res, r.byte);
+    put_varint(res, r.index);
+    res.push_back(r.false_pos ? 1 : 0);
+    put_varint(res, r.window.size());
+    res.insert(res.end(), r.window.begin(), r.window.end());
+    put_varint(res, r.samples.size());
+    int64_t prev = 0;
+    for (auto s : r.samples) {
+        put_varint(res, zigzag(s - prev));
+        prev = s;
+    }
+    uint32_t len = res.size() - sizeof(uint32_t);
+    memcpy(res.data(), &len, sizeof(len));
+    return res;
+}
+
+/*
+    Parse records after magic, end is set to the end of the last full record
+*/
+std::vector<log_record> parse(const uint8_t *begin, size_t size, size_t &end)
+{
+    std::vector<log_record> res;
+    end = sizeof(magic);
+    while (size - end >= sizeof(uint32_t)) {
+        uint32_t len;
+        memcpy(&len, begin + end, sizeof(len));
+        if (len == 0 || len > size - end - sizeof(len))
+            break;
+
+        const uint8_t *p = begin + end + sizeof(len);
+        record_reader rd(p, p + len);
+        log_record r;
+        r.block = rd.varint();
+        r.byte = rd.varint();
+        r.index = rd.varint();
+        r.false_pos = rd.byte() & 1;
+        rd.bytes(r.window, rd.varint());
+        size_t n = rd.varint();
+        for (size_t i = 0; rd.ok() && i < n; ++i)
+            r.samples.push_back((r.samples.empty() ? 0 : r.samples.back()) + unzigzag(rd.varint()));
+        if (!rd.ok())
+            break;
+
+        res.push_back(std::move(r));
+        end += sizeof(len) + len;
+    }
+    return res;
+}
+
+}
+
+measure_log::measure_log(const std::string &path)
+{
+    this->_fd = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (this->_fd < 0)
+        return;
+
+    struct stat st;
+    if (fstat(this->_fd, &st) != 0)
+        return;
+    size_t file_size = st.st_size;
+    if (file_size != 0 && file_size < sizeof(magic))
+        return;
+
+    this->_used = file_size;
+    if (!this->reserve(0))
+        return;
+
+    if (file_size == 0) {
+        memcpy(this->_map, magic, sizeof(magic));
+        this->_used = sizeof(magic);
+    } else if (memcmp(this->_map, magic, sizeof(magic)) == 0) {
+        parse(this->_map, file_size, this->_used);
+    } else {
+        munmap(this->_map, this->_size);
+        this->_map = nullptr;
+    }
+}
+
+measure_log::~measure_log()
+{
+    if (this->_map) {
+        munmap(this->_map, this->_size);
+        ftruncate(this->_fd, this->_used);
+    }
+    if (this->_fd >= 0)
+        close(this->_fd);
+}
+
+bool measure_log::reserve(size_t n)
+{
+    if (this->_map && this->_used + n <= this->_size)
+        return true;
+
+    size_t new_size = std::max({ min_map_size, this->_size * 2, this->_used + n });
+    if (this->_map)
+        munmap(this->_map, this->_size);
+    this->_map = nullptr;
+    if (ftruncate(this->_fd, new_size) != 0)
+        return false;
+
+    void *m = mmap(nullptr, new_size, PROT_READ | PROT_WRITE, MAP_SHARED, this->_fd, 0);
+    if (m == MAP_FAILED)
+        return false;
+    this->_map = (uint8_t*)m;
+    this->_size = new_size;
+    return true;
+}
+
+bool measure_log::append(const log_record &r)
+{
+    auto rec = encode(r);
+    std::lock_guard<std::mutex> lock(this->_mutex);
+    if (!this->reserve(rec.size()))
+        return false;
+
+    // length goes last so a torn record reads as the end of log
+    memcpy(this->_map + this->_used + sizeof(uint32_t), rec.data() + sizeof(uint32_t), rec.size() - sizeof(uint32_t));
+    memcpy(this->_map + this->_used, rec.data(), sizeof(uint32_t));
+    this->_used += rec.size();
+    return true;
+}
+
+bool measure_log::append(const decryptor &d, const dec_option &o, const std::vector<int64_t> &samples, bool false_pos)
+{
+    log_record r;
+    r.block = d.current_block();
+    r.byte = d.current_byte();
+    r.index = o.index;
+    r.false_pos = false_pos;
+    r.window = tail_bytes(false_pos ? o.false_pos_check.value() : o.option, 2 * d.block_size());
+    r.samples = samples;
+    return this->append(r);
+}
+
+std::optional<std::vector<log_record>> measure_log::read(const std::string &path)
+{
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return std::nullopt;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(magic)) {
+        close(fd);
+        return std::nullopt;
+    }
+
+    void *m = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (m == MAP_FAILED)
+        return std::nullopt;
+
+    std::optional<std::vector<log_record>> res;
+    size_t end;
+    if (memcmp(m, magic, sizeof(magic)) == 0)
+        res = parse((const uint8_t*)m, st.st_size, end);
+    munmap(m, st.st_size);
+    return res;
+}
+
+size_t replay(
+    const std::vector<log_record> &log,
+    decryptor &d,
+    std::function<size_t(const std::vector<logged_option>&)> choose)
+{
+    std::map<std::pair<size_t, size_t>, std::vector<const log_record*>> by_pos;
+    for (auto &r : log)
+        by_pos[std::make_pair(r.block, r.byte)].push_back(&r);
+
+    size_t steps = 0;
+    while (d.status() != dec_status::DONE) {
+        auto pos = by_pos.find(std::make_pair(d.current_block(), d.current_byte()));
+        if (pos == by_pos.end())
+            break;
+
+        std::map<size_t, logged_option> opts;
+        for (auto r : pos->second) {
+            if (r->index >= 0x100)
+                continue;
+            auto o = d.option(r->index);
+            if (r->false_pos && !o.false_pos_check)
+                continue;
+            auto &in = r->false_pos ? o.false_pos_check.value() : o.option;
+            if (tail_bytes(in, 2 * d.block_size()) != r->window)
+                continue;
+
+            auto &lo = opts[r->index];
+            lo.index = r->index;
+            auto &dst = r->false_pos ? lo.false_pos_samples : lo.samples;
+            dst.insert(dst.end(), r->samples.begin(), r->samples.end());
+        }
+        if (opts.empty())
+            break;
+
+        std::vector<logged_option> v;
+        for (auto &[i, o] : opts)
+            v.push_back(std::move(o));
+        size_t good = choose(v);
+        if (good >= 0x100)
+            break;
+        d.step(good);
+        ++steps;
+    }
+    return steps;
+}
+
+}
@@ -0,0 +1,83 @@
+#include <algorithm>
+#include "porc/memo.hpp"
+
+namespace porc {
+
+size_t memo_oracle::key_hash::operator()(const std::vector<uint8_t> &v) const
+{
+    // FNV-1a
+    uint64_t h = 0xcbf29ce484222325;
+    for (auto i : v) {
+        h ^= i;
+        h *= 0x100000001b3;
+    }
+    return h;
+}
+
+memo_oracle::memo_oracle(
+    std::function<bool(cipher_desc&)> f,
+    size_t window,
+    memo_policy policy
+) : _f(f), _window(window), _policy(policy), _state(std::make_shared<state>())
+{
+}
+
+std::vector<uint8_t> memo_oracle::key(const cipher_desc &d) const
+{
+    return tail_bytes(d, this->_window ? this->_window : 2 * d.iv.size());
+}
+
+bool memo_oracle::decided(const memo_votes &v) const
+{
+    size_t need = this->_policy.min_queries;
+    if (v.good)
+        need = std::max(need, this->_policy.min_good_queries);
+    if (v.count() < need)
+        return false;
+
+    long double share = (long double)std::max(v.good, v.bad) / v.count();
+    return share >= this->_policy.agreement
+           || v.count() >= std::max(need, this->_policy.max_queries);
+}
+
+bool memo_oracle::operator()(cipher_desc &d)
+{
+    auto k = this->key(d);
+    std::unique_lock<std::mutex> lock(this->_state->mutex);
+    bool asked = false;
+    while (!this->decided(this->_state->votes[k])) {
+        lock.unlock();
+        bool r = this->_f(d);
+        asked = true;
+        lock.lock();
+
+        auto &v = this->_state->votes[k];
+        ++(r ? v.good : v.bad);
+        ++this->_state->queries;
+    }
+    if (!asked)
+        ++this->_state->hits;
+    return this->_state->votes[k].padded();
+}
+
+memo_votes memo_oracle::votes(const cipher_desc &d) const
+{
+    auto k = this->key(d);
+    std::lock_guard<std::mutex> lock(this->_state->mutex);
+    auto i = this->_state->votes.find(k);
+    return i == this->_state->votes.end() ? memo_votes() : i->second;
+}
+
+size_t memo_oracle::queries() const
+{
+    std::lock_guard<std::mutex> lock(this->_state->mutex);
+    return this->_state->queries;
+}
+
+size_t memo_oracle::hits() const
+{
+    std::lock_guard<std::mutex> lock(this->_state->mutex);
+    return this->_state->hits;
+}
+
+}
@@ -13,6 +13,27 @@ uint8_t pkcs7_get_byte(size_t pad_pos, size_t pad_len)
     return pad_len;
 };
 
+std::function<uint8_t(size_t, size_t)> iso7816_get_byte_f(size_t block_size)
+{
+    return [block_size] (size_t pad_pos, size_t pad_len) -> uint8_t {
+        return pad_pos + pad_len == block_size ? 0x80 : 0x00;
+    };
+}
+
+std::vector<uint8_t> tail_bytes(const cipher_desc &d, size_t n)
+{
+    std::vector<uint8_t> res;
+    res.reserve(n);
+    if (n > d.ciphertext.size()) {
+        size_t from_iv = std::min(n - d.ciphertext.size(), d.iv.size());
+        res.insert(res.end(), d.iv.end() - from_iv, d.iv.end());
+        res.insert(res.end(), d.ciphertext.begin(), d.ciphertext.end());
+    } else {
+        res.insert(res.end(), d.ciphertext.end() - n, d.ciphertext.end());
+    }
+    return res;
+}
+
 bool check_opt(std::function<bool(cipher_desc&)> f, dec_option& opt)
 {
     return f(opt.option) && (!opt.false_pos_check.has_value() || f(opt.false_pos_check.value()));
@@ -43,116 +64,280 @@ measure_opt(std::function<uintmax_t(cipher_desc&)> f, dec_option& opt)
 decryptor::decryptor(
     const std::vector<uint8_t> &iv,
     const std::vector<uint8_t> &ciphertext,
-    std::function<uint8_t(size_t, size_t)> get_padding_byte
+    std::function<uint8_t(size_t, size_t)> get_padding_byte,
+    std::shared_ptr<intermediate_cache> cache,
+    bool verify_blocks
 ) : _orig(iv, ciphertext),
     _playground(iv, ciphertext),
+    _plaintext(ciphertext.size()),
+    _plaintext_begin(ciphertext.size()),
+    _intermediate(ciphertext.size()),
+    _confidence(ciphertext.size(), 1),
+    _rejected(iv.size()),
+    _verify(verify_blocks),
+    _known_mask(ciphertext.size()),
+    _known(ciphertext.size()),
     _block_size(iv.size()),
     _block_count(ciphertext.size() / iv.size()),
     _current_block(_block_count - 1),
     _current_byte(iv.size() - 1),
-    _get_padding_byte(get_padding_byte)
+    _get_padding_byte(get_padding_byte),
+    _cache(cache)
 {
     assert(ciphertext.size() % this->_block_size == 0);
+    this->skip_cached();
 }
 
-dec_option decryptor::option(uint8_t v) const
+std::vector<uint8_t> decryptor::ciphertext_block(size_t i) const
 {
-    bool last_byte = this->_current_byte == this->_block_size - 1;
+    assert(i < this->_block_count);
+    auto b = this->_orig.ciphertext.begin() + i * this->_block_size;
+    return std::vector<uint8_t>(b, b + this->_block_size);
+}
 
+std::vector<uint8_t> decryptor::intermediate(size_t block) const
+{
+    assert(block < this->_block_count);
+    assert(this->_status == dec_status::DONE || block > this->_current_block ||
+           (this->_status == dec_status::VERIFY && block == this->_current_block));
+    auto b = this->_intermediate.begin() + block * this->_block_size;
+    return std::vector<uint8_t>(b, b + this->_block_size);
+}
+
+bool decryptor::ambiguous_padding() const
+{
+    if (this->_current_byte == 0)
+        return false;
+    // last byte of pkcs7, or padding that ends the same for longer lengths (ISO 7816-4 zeros):
+    // bytes before the current one can make a longer valid padding
+    size_t pad_len = this->_block_size - this->_current_byte;
+    return pad_len == 1 ||
+        this->_get_padding_byte(this->_block_size - 1, pad_len) ==
+        this->_get_padding_byte(this->_block_size - 1, pad_len + 1);
+}
+
+dec_option decryptor::option(uint8_t v) const
+{
     cipher_desc opt = this->_playground;
     std::optional<cipher_desc> fp = std::nullopt;
 
-    if (this->_block_count == 1) {
-        opt.iv[this->_current_byte] = v;
-        if(last_byte) {
-            fp = opt;
-            *(fp.value().iv.rbegin() + 1) ^= 1;
-        }
-    } else {
-        size_t byte_ind = this->_block_size * (this->_block_count - 2) + this->_current_byte;
-
-        opt.ciphertext[byte_ind] = v;
-        if(last_byte) {
-            fp = opt;
-            *(fp.value().ciphertext.rbegin() + this->_block_size + 1) ^= 1;
-        }
+    this->modified_block(opt)[this->_current_byte] = v;
+    if (this->ambiguous_padding()) {
+        fp = opt;
+        this->modified_block(fp.value())[this->_current_byte - 1] ^= 1;
     }
     return dec_option(v, opt, fp);
 }
 
-void decryptor::apply_padding(
-            std::vector<uint8_t>::const_iterator pm,
-            std::vector<uint8_t>::iterator bi)
-{
-    size_t padlen = this->_block_size - this->_current_byte;
-    size_t padi = this->_current_byte;
-    auto pt = this->_plaintext.begin();
-    assert(this->_plaintext.size() >= padlen);
-    while(padi < this->_block_size) {
-        *bi = *pm ^ *pt ^ this->_get_padding_byte(padi, padlen + 1);
-        ++padi;
-        ++pm;
-        ++bi;
-        ++pt;
+std::vector<uint8_t>::const_iterator decryptor::prev_block(size_t block) const
+{
+    if (block == 0)
+        return this->_orig.iv.cbegin();
+    else
+        return this->_orig.ciphertext.cbegin() + this->_block_size * (block - 1);
+}
+
+std::vector<uint8_t>::iterator decryptor::modified_block(cipher_desc &d) const
+{
+    return this->_block_count == 1 ?
+            d.iv.begin() :
+            d.ciphertext.end() - 2 * this->_block_size;
+}
+
+void decryptor::set_padding(cipher_desc &d, size_t from, size_t pad_len) const
+{
+    auto bi = this->modified_block(d);
+    auto inter = this->_intermediate.cbegin() + this->_block_size * this->_current_block;
+    for (size_t i = from; i < this->_block_size; ++i)
+        bi[i] = inter[i] ^ this->_get_padding_byte(i, pad_len);
+}
+
+void decryptor::commit_byte(uint8_t intermediate, double confidence, bool verify)
+{
+    size_t pos = this->_block_size * this->_current_block + this->_current_byte;
+    this->_intermediate[pos] = intermediate;
+    this->_confidence[pos] = confidence;
+    this->_plaintext[pos] = prev_block(this->_current_block)[this->_current_byte] ^ intermediate;
+    this->_plaintext_begin = pos;
+    this->set_padding(this->_playground, this->_current_byte, this->_block_size - this->_current_byte + 1);
+
+    if(this->_current_byte != 0) {
+        --this->_current_byte;
+        this->_status = dec_status::NONE;
+        return;
     }
+
+    if (verify)
+        this->_status = dec_status::VERIFY;
+    else
+        this->finish_block();
 }
 
-void decryptor::update_plaintext(size_t good_opt)
+void decryptor::finish_block()
 {
-    uint8_t pad = this->_get_padding_byte(this->_current_byte,
-                                            this->_block_size - this->_current_byte);
-    if (this->_block_count == 1 || this->_current_block == 0) {
-        this->_plaintext.push_front(this->_orig.iv[this->_current_byte] ^ pad ^ good_opt);
+    if (this->_cache) {
+        auto inter = this->_intermediate.begin() + this->_block_size * this->_current_block;
+        this->_cache->put(this->ciphertext_block(this->_current_block),
+                          std::vector<uint8_t>(inter, inter + this->_block_size));
+    }
+
+    if (this->_on_block)
+        this->_on_block(this->_current_block,
+                        byte_span(this->_plaintext.data() + this->_plaintext_begin, this->_block_size));
+
+    for (auto &r : this->_rejected)
+        r.reset();
+    this->_current_byte = this->_block_size - 1;
+    if(this->_current_block == 0) {
+        this->_status = dec_status::DONE;
     } else {
-        size_t bi = this->_block_size * (this->_current_block - 1) + this->_current_byte;
-        this->_plaintext.push_front(this->_orig.ciphertext[bi] ^ pad ^ good_opt);
+        --this->_current_block;
+        std::copy(
+            this->_orig.ciphertext.begin() + this->_current_block * this->_block_size,
+            this->_orig.ciphertext.begin() + (this->_current_block + 1) * this->_block_size,
+            this->_playground.ciphertext.end() - this->_block_size);
+
+        this->_status = dec_status::NEW_BLOCK;
     }
 }
 
-void decryptor::update_playground()
+void decryptor::on_block(std::function<void(size_t, byte_span)> f)
 {
-    if (this->_block_count == 1) {
-        this->apply_padding(this->_orig.iv.cbegin() + this->_current_byte,
-                            this->_playground.iv.begin() + this->_current_byte);
-    } else {
-        size_t play_byte = this->_block_size * (this->_block_count - 2) + this->_current_byte;
-
-        size_t pos_block = std::max<size_t>(1, this->_current_block) - 1;
-        size_t ori_offset = this->_block_size * pos_block + this->_current_byte;
-        auto ori = this->_current_block == 0 ?
-                        this->_orig.iv.cbegin() + ori_offset :
-                        this->_orig.ciphertext.cbegin() + ori_offset;
-        this->apply_padding(ori,
-                            this->_playground.ciphertext.begin() + play_byte);
+    this->_on_block = f;
+    if (!f)
+        return;
+    size_t first = this->_status == dec_status::DONE ? 0 : this->_current_block + 1;
+    for (size_t i = this->block_count(); i-- > first;)
+        f(i, byte_span(this->_plaintext.data() + i * this->_block_size, this->_block_size));
+}
+
+void decryptor::skip_cached()
+{
+    if (!this->_cache)
+        return;
+
+    while (this->_status != dec_status::DONE) {
+        auto inter = this->_cache->get(this->ciphertext_block(this->_current_block));
+        if (!inter)
+            return;
+        do {
+            this->commit_byte(inter.value()[this->_current_byte], 1, false);
+        } while (this->_status == dec_status::NONE);
     }
 }
 
-dec_status decryptor::step(size_t good_opt)
+bool decryptor::has_known(size_t block) const
 {
-    assert(good_opt < 0x100);
-    this->update_plaintext(good_opt);
-    this->update_playground();
-
-
-    if(this->_current_byte == 0) {
-        this->_current_byte = this->_block_size - 1;
-        if(this->_current_block == 0) {
-            this->_status = dec_status::DONE;
-            return this->_status;
-        } else {
-            --this->_current_block;
-            std::copy(
-                this->_orig.ciphertext.begin() + this->_current_block * this->_block_size,
-                this->_orig.ciphertext.begin() + (this->_current_block + 1) * this->_block_size,
-                this->_playground.ciphertext.end() - this->_block_size);
-
-            this->_status = dec_status::NEW_BLOCK;
-            return this->_status;
+    auto b = this->_known_mask.begin() + block * this->_block_size;
+    return std::find(b, b + this->_block_size, true) != b + this->_block_size;
+}
+
+void decryptor::skip_known()
+{
+    while (this->_status == dec_status::NONE || this->_status == dec_status::NEW_BLOCK) {
+        size_t pos = this->_block_size * this->_current_block + this->_current_byte;
+        if (!this->_known_mask[pos])
+            return;
+        // below any searched byte, verification blames the guess first
+        this->commit_byte(this->_known[pos] ^ prev_block(this->_current_block)[this->_current_byte], 0, true);
+        if (this->_status == dec_status::NEW_BLOCK)
+            this->skip_cached();
+    }
+}
+
+void decryptor::set_known(size_t offset, const std::vector<uint8_t> &bytes)
+{
+    assert(offset + bytes.size() <= this->_known.size());
+    std::copy(bytes.begin(), bytes.end(), this->_known.begin() + offset);
+    std::fill(this->_known_mask.begin() + offset, this->_known_mask.begin() + offset + bytes.size(), true);
+    this->skip_known();
+}
+
+size_t decryptor::next_allowed(size_t ind) const
+{
+    while (ind < 0x100 && this->rejected(ind))
+        ++ind;
+    return ind;
+}
+
+cipher_desc decryptor::verification() const
+{
+    assert(this->_status == dec_status::VERIFY);
+    cipher_desc res = this->_playground;
+    this->set_padding(res, 0, this->_block_size);
+    // the option of byte 0 was this very input, change IV (it plays no part
+    // in padding of messages with several blocks) to get a new answer
+    if (this->_block_count > 1)
+        res.iv[0] ^= 1;
+    return res;
+}
+
+dec_status decryptor::verified(bool good)
+{
+    assert(this->_status == dec_status::VERIFY);
+    if (good) {
+        this->finish_block();
+        if (this->_status == dec_status::NEW_BLOCK)
+            this->skip_cached();
+        this->skip_known();
+        return this->_status;
+    }
+
+    this->go_back(0);
+    return this->_status;
+}
+
+bool decryptor::no_good_option()
+{
+    assert(this->_status == dec_status::NONE || this->_status == dec_status::NEW_BLOCK);
+    if (this->_current_byte + 1 == this->_block_size)
+        return false;
+    this->go_back(this->_current_byte + 1);
+    return true;
+}
+
+void decryptor::go_back(size_t from)
+{
+    // ties go to the byte decrypted last, it's the cheapest to redo
+    auto conf = this->_confidence.begin() + this->_block_size * this->_current_block;
+    size_t worst = std::min_element(conf + from, conf + this->_block_size) - conf;
+    auto known = this->_known_mask.begin() + this->_block_size * this->_current_block;
+    bool guess = known[worst];
+    if (guess) {
+        // known plaintext of the block is wrong somewhere: search for all of it,
+        // starting from the known byte decrypted first, no option to reject
+        for (size_t i = from; i < this->_block_size; ++i) {
+            if (known[i])
+                worst = i;
+            known[i] = false;
         }
-    } else {
-        --this->_current_byte;
     }
+
+    for (size_t i = worst + 1; i < this->_block_size; ++i)
+        conf[i] /= 2;
+    for (size_t i = 0; i < worst; ++i)
+        this->_rejected[i].reset();
+    if (!guess) {
+        size_t pos = this->_block_size * this->_current_block + worst;
+        this->_rejected[worst].set(this->_intermediate[pos] ^ this->_get_padding_byte(worst, this->_block_size - worst));
+    }
+
+    this->_plaintext_begin = this->_block_size * this->_current_block + worst + 1;
+    this->_current_byte = worst;
+    this->set_padding(this->_playground, worst + 1, this->_block_size - worst);
     this->_status = dec_status::NONE;
+}
+
+dec_status decryptor::step(size_t good_opt, double confidence)
+{
+    assert(good_opt < 0x100);
+    assert(this->_status != dec_status::VERIFY);
+    uint8_t pad = this->_get_padding_byte(this->_current_byte,
+                                          this->_block_size - this->_current_byte);
+    this->commit_byte(good_opt ^ pad, confidence, this->_verify || this->has_known(this->_current_block));
+    if (this->_status == dec_status::NEW_BLOCK)
+        this->skip_cached();
+    this->skip_known();
     return this->_status;
 }
 
@@ -0,0 +1,212 @@
+#include <algorithm>
+#include <bitset>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include "porc/posterior.hpp"
+
+namespace porc {
+
+namespace {
+
+double xlogx(double x)
+{
+    return x > 0 ? x * std::log(x) : 0;
+}
+
+}
+
+evidence bool_evidence(std::function<bool(cipher_desc&)> f, double false_positive, double false_negative)
+{
+    assert(false_positive > 0 && false_positive < 0.5);
+    assert(false_negative > 0 && false_negative < 0.5);
+    double yes = std::log((1 - false_negative) / false_positive);
+    double no = std::log(false_negative / (1 - false_positive));
+
+    evidence res;
+    res.log_ratio = [f, yes, no](cipher_desc &d) { return f(d) ? yes : no; };
+    res.false_positive = false_positive;
+    res.false_negative = false_negative;
+    return res;
+}
+
+byte_posterior::byte_posterior(double none_prior) : _log(0x100, 0)
+{
+    assert(none_prior >= 0 && none_prior < 1);
+    this->_none = std::log(0x100 * none_prior / (1 - none_prior));
+}
+
+void byte_posterior::exclude(uint8_t v)
+{
+    this->_log[v] = -std::numeric_limits<double>::infinity();
+}
+
+void byte_posterior::observe(uint8_t v, double log_ratio)
+{
+    this->_log[v] += log_ratio;
+}
+
+std::vector<double> byte_posterior::probabilities() const
+{
+    double max = std::max(*std::max_element(this->_log.begin(), this->_log.end()), this->_none);
+    std::vector<double> res(this->_log.size(), 0);
+    if (std::isinf(max))
+        return res;
+
+    double sum = std::exp(this->_none - max);
+    for (size_t v = 0; v < res.size(); ++v)
+        sum += res[v] = std::exp(this->_log[v] - max);
+    for (auto &p : res)
+        p /= sum;
+    return res;
+}
+
+double byte_posterior::probability(uint8_t v) const
+{
+    return this->probabilities()[v];
+}
+
+double byte_posterior::probability_none() const
+{
+    auto q = this->probabilities();
+    return 1 - std::accumulate(q.begin(), q.end(), 0.0);
+}
+
+uint8_t byte_posterior::best() const
+{
+    return std::max_element(this->_log.begin(), this->_log.end()) - this->_log.begin();
+}
+
+double byte_posterior::entropy() const
+{
+    double res = -xlogx(this->probability_none());
+    for (auto p : this->probabilities())
+        res -= xlogx(p);
+    return res;
+}
+
+uint8_t byte_posterior::next(double false_positive, double false_negative) const
+{
+    auto q = this->probabilities();
+    double h = this->entropy();
+
+    // only the queried option changes relative to the rest:
+    // rest is scaled by c, entropy of the rest becomes c * h_rest - c log c * (1 - p)
+    auto after = [](double p, double h_rest, double p_ans, double v_ans, double c) {
+        return -xlogx(p * v_ans / p_ans) + c * h_rest - xlogx(c) * (1 - p);
+    };
+
+    uint8_t res = this->best();
+    double best_gain = -1;
+    for (size_t v = 0; v < q.size(); ++v) {
+        double p = q[v];
+        if (p == 0)
+            continue;
+        double h_rest = h + xlogx(p);
+        double yes = p * (1 - false_negative) + (1 - p) * false_positive;
+        double no = 1 - yes;
+        double h_after = yes * after(p, h_rest, yes, 1 - false_negative, false_positive / yes) +
+                         no * after(p, h_rest, no, false_negative, (1 - false_positive) / no);
+        if (h - h_after > best_gain) {
+            best_gain = h - h_after;
+            res = v;
+        }
+    }
+    return res;
+}
+
+posterior_runner::posterior_runner(const evidence &e, const posterior_options &opts)
+    : _e(e), _opts(opts)
+{
+    assert(this->_opts.threshold > 0.5 && this->_opts.threshold < 1);
+}
+
+double posterior_runner::ask(cipher_desc &d)
+{
+    ++this->_queries;
+    return this->_e.log_ratio(d);
+}
+
+std::optional<double> posterior_runner::decide(cipher_desc &d, size_t start)
+{
+    double log_odds = 0;
+    double limit = std::log(this->_opts.threshold / (1 - this->_opts.threshold));
+    while (std::abs(log_odds) < limit) {
+        if (this->_opts.max_queries && this->_queries - start >= this->_opts.max_queries)
+            return std::nullopt;
+        log_odds += this->ask(d);
+    }
+    return log_odds;
+}
+
+bool posterior_runner::verify(decryptor &d)
+{
+    // confidences of filled bytes say nothing, start from even odds
+    auto v = d.verification();
+    auto log_odds = this->decide(v, this->_queries);
+    if (!log_odds)
+        return false;
+    d.verified(*log_odds > 0);
+    return true;
+}
+
+bool posterior_runner::run(decryptor &d)
+{
+    while (d.status() != dec_status::DONE) {
+        if (d.status() == dec_status::VERIFY) {
+            if (!this->verify(d))
+                return false;
+            continue;
+        }
+
+        byte_posterior post(this->_opts.none);
+        for (size_t v = 0; v < 0x100; ++v)
+            if (d.rejected(v))
+                post.exclude(v);
+
+        size_t start = this->_queries;
+        std::bitset<0x100> checked;
+        while (post.probability_none() < this->_opts.threshold) {
+            uint8_t best = post.best();
+            if (post.probability(best) >= this->_opts.threshold) {
+                auto o = d.option(best);
+                if (!o.false_pos_check || checked[best])
+                    break;
+                // false positives answer like good options, only false_pos_check
+                // tells them apart: asked once, for the option about to be committed
+                auto fp = o.false_pos_check.value();
+                auto r = this->decide(fp, start);
+                if (!r)
+                    return false;
+                checked[best] = true;
+                if (*r > 0)
+                    post.observe(best, *r);
+                else
+                    post.exclude(best);
+                continue;
+            }
+            if (this->_opts.max_queries && this->_queries - start >= this->_opts.max_queries)
+                return false;
+            uint8_t v = post.next(this->_e.false_positive, this->_e.false_negative);
+            auto o = d.option(v);
+            post.observe(v, this->ask(o.option));
+        }
+        if (post.probability(post.best()) < this->_opts.threshold) {
+            if (!d.verify_blocks())
+                return false;
+            // bytes before the wrong one have no good option either
+            do {
+                if (d.begin() == d.end())
+                    return false;
+                d.step(d.begin(), 1);
+            } while (d.status() == dec_status::NONE);
+            continue;
+        }
+        uint8_t best = post.best();
+        d.step(best, post.probability(best));
+    }
+    return true;
+}
+
+}
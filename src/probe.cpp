@@ -0,0 +1,178 @@
+#include <cassert>
+#include "porc/probe.hpp"
+
+namespace porc {
+
+namespace {
+
+class asker {
+    std::function<bool(const std::vector<uint8_t>&)> _f;
+    size_t _repeats;
+
+    public:
+        size_t queries = 0;
+        size_t answers = 0;
+        size_t agreeing = 0;
+
+        asker(std::function<bool(const std::vector<uint8_t>&)> f, size_t repeats)
+            : _f(f), _repeats(repeats) { }
+
+        bool once(const std::vector<uint8_t> &m)
+        {
+            ++this->queries;
+            return this->_f(m);
+        }
+
+        // majority of repeated answers
+        bool ask(const std::vector<uint8_t> &m)
+        {
+            size_t good = 0;
+            for (size_t i = 0; i < this->_repeats; ++i)
+                good += this->once(m);
+            bool res = 2 * good > this->_repeats;
+            this->answers += this->_repeats;
+            this->agreeing += res ? good : this->_repeats - good;
+            return res;
+        }
+
+        // unlikely good answers need repeats more good answers in a row
+        bool rare(const std::vector<uint8_t> &m)
+        {
+            ++this->answers;
+            if (!this->once(m)) {
+                ++this->agreeing;
+                return false;
+            }
+            size_t asked = 0;
+            bool res = true;
+            for (size_t i = 0; res && i < this->_repeats; ++i, ++asked)
+                res = this->once(m);
+            this->answers += asked;
+            // rejected: only the last, bad answer agrees
+            this->agreeing += res ? asked + 1 : 1;
+            return res;
+        }
+};
+
+}
+
+decryptor probe_result::make_decryptor(std::shared_ptr<intermediate_cache> cache) const
+{
+    return decryptor(this->input.iv, this->input.ciphertext, this->get_padding_byte, cache, this->reliability < 1);
+}
+
+std::optional<probe_result> probe(
+    const std::vector<uint8_t> &message,
+    std::function<bool(const std::vector<uint8_t>&)> f,
+    const probe_options &opts)
+{
+    assert(opts.repeats > 0);
+    assert(!opts.block_sizes.empty());
+    for (size_t i = 1; i < opts.block_sizes.size(); ++i)
+        assert(opts.block_sizes[i] >= 2 * opts.block_sizes[i - 1]);
+
+    asker a(f, opts.repeats);
+    if (message.empty() || !a.ask(message))
+        return std::nullopt;
+
+    // flipping k-th byte from the end breaks padding while it's in the last block
+    // or in the bytes of the block before that xor the padding: k < block size + padding length.
+    // Garbled last block has good padding by chance, another flip makes that unlikely
+    auto flipped_good = [&](size_t k) {
+        for (uint8_t x : { 0x01, 0x80 }) {
+            auto m = message;
+            m[m.size() - 1 - k] ^= x;
+            if (!a.ask(m))
+                return false;
+        }
+        return true;
+    };
+    size_t lo = 0;
+    size_t hi = std::min(message.size(), 2 * opts.block_sizes.back());
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (flipped_good(mid))
+            hi = mid;
+        else
+            lo = mid + 1;
+    }
+
+    probe_result res;
+    for (auto b : opts.block_sizes) {
+        if (b < lo && lo <= 2 * b && message.size() % b == 0 && message.size() >= 2 * b) {
+            res.block_size = b;
+            break;
+        }
+    }
+    if (res.block_size == 0)
+        return std::nullopt;
+    size_t bs = res.block_size;
+    res.padding_length = lo - bs;
+
+    // last byte of the block before the last one
+    size_t last = message.size() - 1 - bs;
+    if (res.padding_length > 1) {
+        auto m = message;
+        m[last] ^= res.padding_length ^ 0x01;
+        bool pkcs7 = a.ask(m);
+        m = message;
+        m[last] ^= 0x80;
+        bool iso = a.ask(m);
+        if (pkcs7 == iso)
+            return std::nullopt;
+        res.padding = pkcs7 ? padding_scheme::PKCS7 : padding_scheme::ISO7816;
+    } else {
+        // last byte is 0x01 or 0x80, make it the end of length 2 padding
+        // and search for the byte before, only the right guess has one
+        auto pad2 = [&](uint8_t last_xor) {
+            auto m = message;
+            m[last] ^= last_xor;
+            for (size_t v = 0; v < 0x100; ++v) {
+                m[last - 1] = message[last - 1] ^ v;
+                if (a.rare(m))
+                    return true;
+            }
+            return false;
+        };
+        if (pad2(0x01 ^ 0x02))
+            res.padding = padding_scheme::PKCS7;
+        else if (pad2(0x80))
+            res.padding = padding_scheme::ISO7816;
+        else
+            return std::nullopt;
+    }
+    res.get_padding_byte = res.padding == padding_scheme::PKCS7 ?
+        std::function<uint8_t(size_t, size_t)>(pkcs7_get_byte) : iso7816_get_byte_f(bs);
+
+    // server without the IV in the message decrypts a single block with its own IV,
+    // with IV prepended a single block is never good
+    if (opts.iv_queries) {
+        std::vector<uint8_t> one(message.end() - bs, message.end());
+        bool prepended = true;
+        for (size_t i = 0; prepended && i < opts.iv_queries; ++i) {
+            one[0] = i;
+            one[1] = i >> 8;
+            prepended = !a.rare(one);
+        }
+        res.iv_prepended = prepended;
+    }
+
+    res.reliability = a.answers ? (double)a.agreeing / a.answers : 1;
+    res.queries = a.queries;
+    res.input.iv.assign(message.begin(), message.begin() + bs);
+    res.input.ciphertext.assign(message.begin() + bs, message.end());
+    return res;
+}
+
+std::function<bool(cipher_desc&)> message_oracle(std::function<bool(const std::vector<uint8_t>&)> f)
+{
+    return [f] (cipher_desc &d) {
+        std::vector<uint8_t> m;
+        m.reserve(d.iv.size() + d.ciphertext.size());
+        m.insert(m.end(), d.iv.begin(), d.iv.end());
+        m.insert(m.end(), d.ciphertext.begin(), d.ciphertext.end());
+        return f(m);
+    };
+}
+
+}
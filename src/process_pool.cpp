@@ -0,0 +1,261 @@
+#include <atomic>
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <new>
+#include <semaphore.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "porc/process_pool.hpp"
+
+namespace porc {
+
+namespace {
+
+const uint32_t stop_index = UINT32_MAX;
+
+struct pool_header {
+    // posted by workers, once per result
+    sem_t results;
+};
+
+struct worker_header {
+    // posted by driver, once per queued input
+    sem_t requests;
+    // inputs done by worker
+    std::atomic<uint32_t> done;
+};
+
+/*
+    Slot of a ring buffer, followed by
+    option iv, option ciphertext, false_pos_check iv, false_pos_check ciphertext
+*/
+struct slot_header {
+    uint32_t index;
+    uint32_t sizes[4];
+    uint8_t has_fp;
+    uint8_t result;
+};
+
+size_t align(size_t v)
+{
+    return (v + 63) / 64 * 64;
+}
+
+pool_header * pool_hdr(void *shm)
+{
+    return (pool_header*)shm;
+}
+
+worker_header * worker_hdr(void *shm, size_t worker)
+{
+    return (worker_header*)((uint8_t*)shm + align(sizeof(pool_header)) + worker * align(sizeof(worker_header)));
+}
+
+void retry_wait(sem_t *s)
+{
+    while (sem_wait(s) == -1 && errno == EINTR)
+        ;
+}
+
+}
+
+process_pool::process_pool(
+    std::function<bool(cipher_desc&)> f,
+    size_t workers,
+    size_t max_input,
+    size_t ring_size
+) : _f(f),
+    _max_input(max_input),
+    _ring_size(ring_size),
+    _slot_size(align(sizeof(slot_header) + 2 * max_input)),
+    _alive(workers, true),
+    _sent(workers),
+    _received(workers)
+{
+    assert(workers > 0 && ring_size > 0);
+    this->_shm_size = align(sizeof(pool_header))
+                      + workers * align(sizeof(worker_header))
+                      + workers * ring_size * this->_slot_size;
+    this->_shm = mmap(nullptr, this->_shm_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    assert(this->_shm != MAP_FAILED);
+
+    sem_init(&(new (pool_hdr(this->_shm)) pool_header)->results, 1, 0);
+    for (size_t w = 0; w < workers; ++w) {
+        auto wh = new (worker_hdr(this->_shm, w)) worker_header;
+        sem_init(&wh->requests, 1, 0);
+        wh->done = 0;
+    }
+
+    for (size_t w = 0; w < workers; ++w) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            this->worker_loop(w);
+            _exit(0);
+        }
+        assert(pid > 0);
+        this->_workers.push_back(pid);
+    }
+}
+
+process_pool::~process_pool()
+{
+    for (size_t w = 0; w < this->_workers.size(); ++w) {
+        if (!this->_alive[w])
+            continue;
+        ((slot_header*)this->slot(w, this->_sent[w]))->index = stop_index;
+        sem_post(&worker_hdr(this->_shm, w)->requests);
+    }
+    for (size_t w = 0; w < this->_workers.size(); ++w) {
+        if (this->_alive[w])
+            waitpid(this->_workers[w], nullptr, 0);
+        sem_destroy(&worker_hdr(this->_shm, w)->requests);
+    }
+    sem_destroy(&pool_hdr(this->_shm)->results);
+    munmap(this->_shm, this->_shm_size);
+}
+
+uint8_t * process_pool::slot(size_t worker, uint32_t n) const
+{
+    return (uint8_t*)this->_shm
+           + align(sizeof(pool_header))
+           + this->_alive.size() * align(sizeof(worker_header))
+           + (worker * this->_ring_size + n % this->_ring_size) * this->_slot_size;
+}
+
+void process_pool::worker_loop(size_t worker)
+{
+    auto wh = worker_hdr(this->_shm, worker);
+    for (uint32_t n = 0;; ++n) {
+        retry_wait(&wh->requests);
+
+        auto s = this->slot(worker, n);
+        auto h = (slot_header*)s;
+        if (h->index == stop_index)
+            return;
+
+        std::vector<uint8_t> parts[4];
+        const uint8_t *data = s + sizeof(slot_header);
+        for (size_t i = 0; i < 4; ++i) {
+            parts[i].assign(data, data + h->sizes[i]);
+            data += h->sizes[i];
+        }
+
+        cipher_desc opt(parts[0], parts[1]);
+        std::optional<cipher_desc> fp;
+        if (h->has_fp)
+            fp = cipher_desc(parts[2], parts[3]);
+        dec_option o(h->index, opt, fp);
+        h->result = check_opt(this->_f, o);
+
+        wh->done.store(n + 1, std::memory_order_release);
+        sem_post(&pool_hdr(this->_shm)->results);
+    }
+}
+
+bool process_pool::has_room(size_t worker) const
+{
+    return this->_alive[worker] && this->_sent[worker] - this->_received[worker] < this->_ring_size;
+}
+
+void process_pool::submit(size_t worker, uint32_t index, const dec_option &opt)
+{
+    assert(this->has_room(worker));
+    auto s = this->slot(worker, this->_sent[worker]);
+    auto h = (slot_header*)s;
+    const std::vector<uint8_t> *parts[4] = {
+        &opt.option.iv, &opt.option.ciphertext, nullptr, nullptr
+    };
+    if (opt.false_pos_check) {
+        parts[2] = &opt.false_pos_check->iv;
+        parts[3] = &opt.false_pos_check->ciphertext;
+    }
+    assert(parts[0]->size() + parts[1]->size() <= this->_max_input);
+
+    h->index = index;
+    h->has_fp = opt.false_pos_check.has_value();
+    uint8_t *data = s + sizeof(slot_header);
+    for (size_t i = 0; i < 4; ++i) {
+        h->sizes[i] = parts[i] ? parts[i]->size() : 0;
+        if (parts[i])
+            memcpy(data, parts[i]->data(), h->sizes[i]);
+        data += h->sizes[i];
+    }
+
+    ++this->_sent[worker];
+    sem_post(&worker_hdr(this->_shm, worker)->requests);
+}
+
+void process_pool::check_workers()
+{
+    for (size_t w = 0; w < this->_workers.size(); ++w)
+        if (this->_alive[w] && waitpid(this->_workers[w], nullptr, WNOHANG) == this->_workers[w])
+            this->_alive[w] = false;
+}
+
+void process_pool::wait_result(uint32_t &index, bool &result)
+{
+    for (;;) {
+        // dead worker might not have posted its last result
+        // and never answers the rest of its inputs
+        for (size_t w = 0; w < this->_workers.size(); ++w) {
+            if (this->_alive[w] || this->_received[w] == this->_sent[w])
+                continue;
+            auto done = worker_hdr(this->_shm, w)->done.load(std::memory_order_acquire);
+            auto h = (slot_header*)this->slot(w, this->_received[w]);
+            index = h->index;
+            result = this->_received[w] < done && h->result;
+            ++this->_received[w];
+            return;
+        }
+
+        timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        ts.tv_sec += 1;
+        if (sem_timedwait(&pool_hdr(this->_shm)->results, &ts) == -1) {
+            if (errno == ETIMEDOUT)
+                this->check_workers();
+            continue;
+        }
+
+        for (size_t w = 0; w < this->_workers.size(); ++w) {
+            auto done = worker_hdr(this->_shm, w)->done.load(std::memory_order_acquire);
+            if (this->_received[w] < done) {
+                auto h = (slot_header*)this->slot(w, this->_received[w]);
+                index = h->index;
+                result = h->result;
+                ++this->_received[w];
+                return;
+            }
+        }
+    }
+}
+
+size_t process_pool::find_option(std::function<dec_option(uint8_t)> option)
+{
+    size_t found = 0x100;
+    size_t next = 0;
+    size_t pending = 0;
+    for (;;) {
+        for (size_t w = 0; next < found && w < this->_workers.size(); ++w) {
+            while (next < found && this->has_room(w)) {
+                this->submit(w, next, option(next));
+                ++next;
+                ++pending;
+            }
+        }
+        if (pending == 0)
+            return found;
+
+        uint32_t index;
+        bool result;
+        this->wait_result(index, result);
+        --pending;
+        if (result && index < found)
+            found = index;
+    }
+}
+
+}
@@ -0,0 +1,98 @@
+#include <algorithm>
+#include <utility>
+#include <vector>
+#include "porc/response.hpp"
+
+namespace porc {
+
+response_oracle::response_oracle(std::function<uint64_t(cipher_desc&)> f, size_t learn_queries)
+    : _f(f), _learn_queries(std::max<size_t>(learn_queries, 1))
+{
+}
+
+uint64_t response_oracle::query(cipher_desc &d)
+{
+    uint64_t r = this->_f(d);
+    ++this->_total;
+    if (++this->_counts[r] > this->_counts[this->_invalid])
+        this->_invalid = r;
+    return r;
+}
+
+bool response_oracle::learning() const
+{
+    return this->_total < this->_learn_queries;
+}
+
+bool response_oracle::separated(size_t pad_len) const
+{
+    auto it = this->_pad.find(pad_len);
+    if (it == this->_pad.end() || this->_pad.size() < 2)
+        return false;
+    return std::none_of(it->second.begin(), it->second.end(),
+                        [this, pad_len](uint64_t r) { return this->other_length(pad_len, r); });
+}
+
+bool response_oracle::other_length(size_t pad_len, uint64_t r) const
+{
+    return std::any_of(this->_pad.begin(), this->_pad.end(),
+                       [pad_len, r](auto &p) { return p.first != pad_len && p.second.count(r) != 0; });
+}
+
+bool response_oracle::confirm(const dec_option &opt, uint64_t r, size_t pad_len)
+{
+    if (r == this->_invalid)
+        return false;
+    if (!opt.false_pos_check) {
+        // options without false_pos_check can't be false positives
+        this->_pad[pad_len].insert(r);
+        return true;
+    }
+
+    // false positives have longer padding
+    if (this->separated(pad_len)) {
+        if (this->_pad.at(pad_len).count(r)) {
+            ++this->_saved;
+            return true;
+        }
+        if (this->other_length(pad_len, r)) {
+            ++this->_saved;
+            return false;
+        }
+    }
+
+    auto fp = opt.false_pos_check.value();
+    bool good = this->query(fp) != this->_invalid;
+    if (good)
+        this->_pad[pad_len].insert(r);
+    return good;
+}
+
+size_t response_oracle::find_option(std::function<dec_option(uint8_t)> option, size_t pad_len)
+{
+    // responses before bad padding is known, decided once it is
+    std::vector<std::pair<size_t, uint64_t>> pending;
+    for (size_t v = 0; v < 0x100; ++v) {
+        auto o = option(v);
+        uint64_t r = this->query(o.option);
+        if (this->learning() || !pending.empty()) {
+            pending.emplace_back(v, r);
+            if (this->learning())
+                continue;
+            for (auto &[i, pr] : pending)
+                if (this->confirm(i == v ? o : option(i), pr, pad_len))
+                    return i;
+            pending.clear();
+            continue;
+        }
+        if (this->confirm(o, r, pad_len))
+            return v;
+    }
+
+    for (auto &[i, pr] : pending)
+        if (this->confirm(option(i), pr, pad_len))
+            return i;
+    return 0x100;
+}
+
+}
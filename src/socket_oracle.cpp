@@ -0,0 +1,337 @@
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <memory>
+#include <netdb.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "porc/socket_oracle.hpp"
+
+namespace porc {
+
+namespace {
+
+const size_t fp_flag = 0x1000;
+const std::string unix_prefix = "unix:";
+
+int open_socket(const std::string &address)
+{
+    if (address.compare(0, unix_prefix.size(), unix_prefix) == 0) {
+        sockaddr_un sa = {};
+        sa.sun_family = AF_UNIX;
+        std::string path = address.substr(unix_prefix.size());
+        if (path.size() >= sizeof(sa.sun_path))
+            return -1;
+        memcpy(sa.sun_path, path.c_str(), path.size() + 1);
+        int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd >= 0 && ::connect(fd, (sockaddr*)&sa, sizeof(sa)) != 0) {
+            close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    size_t colon = address.rfind(':');
+    if (colon == std::string::npos)
+        return -1;
+    addrinfo hints = {};
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo *res = nullptr;
+    if (getaddrinfo(address.substr(0, colon).c_str(), address.substr(colon + 1).c_str(), &hints, &res) != 0)
+        return -1;
+
+    int fd = -1;
+    for (auto ai = res; ai && fd < 0; ai = ai->ai_next) {
+        fd = socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC, ai->ai_protocol);
+        if (fd >= 0 && ::connect(fd, ai->ai_addr, ai->ai_addrlen) != 0) {
+            close(fd);
+            fd = -1;
+        }
+    }
+    freeaddrinfo(res);
+    return fd;
+}
+
+}
+
+size_t frame_line(std::string_view buf)
+{
+    size_t nl = buf.find('\n');
+    return nl == std::string_view::npos ? 0 : nl + 1;
+}
+
+std::function<void(const cipher_desc&, std::string&)> request_template(
+    const std::string &tmpl,
+    encoding e,
+    const std::string &placeholder)
+{
+    size_t pos = tmpl.find(placeholder);
+    assert(pos != std::string::npos);
+    auto prefix = tmpl.substr(0, pos);
+    auto suffix = tmpl.substr(pos + placeholder.size());
+    auto enc = std::make_shared<encoder>(e);
+    auto data = std::make_shared<std::string>();
+    return [=](const cipher_desc &d, std::string &req) {
+        enc->encode(d, *data);
+        req.assign(prefix);
+        req.append(*data);
+        req.append(suffix);
+    };
+}
+
+socket_oracle::socket_oracle(
+    const std::string &address,
+    std::function<void(const cipher_desc&, std::string&)> make_request,
+    response_framing framing,
+    std::function<bool(std::string_view)> is_padded,
+    socket_options opts
+) : _address(address),
+    _make_request(make_request),
+    _framing(framing),
+    _is_padded(is_padded),
+    _opts(opts),
+    _conns(std::max<size_t>(opts.connections, 1))
+{
+    assert(this->_opts.pipeline > 0);
+    this->_epoll = epoll_create1(EPOLL_CLOEXEC);
+    this->_ok = this->_epoll >= 0;
+    for (size_t c = 0; this->_ok && c < this->_conns.size(); ++c)
+        this->_ok = this->connect(c);
+}
+
+socket_oracle::~socket_oracle()
+{
+    for (size_t c = 0; c < this->_conns.size(); ++c)
+        this->disconnect(c);
+    if (this->_epoll >= 0)
+        close(this->_epoll);
+}
+
+bool socket_oracle::connect(size_t c)
+{
+    auto &conn = this->_conns[c];
+    conn.fd = open_socket(this->_address);
+    if (conn.fd < 0)
+        return false;
+    fcntl(conn.fd, F_SETFL, fcntl(conn.fd, F_GETFL) | O_NONBLOCK);
+
+    epoll_event ev = {};
+    ev.events = EPOLLIN;
+    ev.data.u64 = c;
+    conn.want_write = false;
+    return epoll_ctl(this->_epoll, EPOLL_CTL_ADD, conn.fd, &ev) == 0;
+}
+
+void socket_oracle::disconnect(size_t c)
+{
+    auto &conn = this->_conns[c];
+    if (conn.fd >= 0)
+        close(conn.fd);
+    conn.fd = -1;
+    conn.out.clear();
+    conn.in.clear();
+}
+
+bool socket_oracle::reconnect(size_t c)
+{
+    ++this->_reconnects;
+    auto &conn = this->_conns[c];
+    this->disconnect(c);
+    if (!this->connect(c))
+        return false;
+
+    // requests without answer go again, in the same order
+    std::deque<task> pending;
+    std::swap(pending, conn.pending);
+    this->_in_flight -= pending.size();
+    for (auto &t : pending)
+        this->submit(c, std::move(t));
+    return this->flush(c);
+}
+
+void socket_oracle::submit(size_t c, task t)
+{
+    auto &conn = this->_conns[c];
+    this->_make_request(t.input, this->_request);
+    conn.out.append(this->_request);
+    conn.pending.push_back(std::move(t));
+    ++this->_in_flight;
+}
+
+bool socket_oracle::flush(size_t c)
+{
+    auto &conn = this->_conns[c];
+    while (!conn.out.empty()) {
+        ssize_t n = send(conn.fd, conn.out.data(), conn.out.size(), MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            break;
+        if (n <= 0)
+            return false;
+        conn.out.erase(0, n);
+    }
+
+    bool want_write = !conn.out.empty();
+    if (want_write != conn.want_write) {
+        epoll_event ev = {};
+        ev.events = EPOLLIN | (want_write ? EPOLLOUT : 0);
+        ev.data.u64 = c;
+        epoll_ctl(this->_epoll, EPOLL_CTL_MOD, conn.fd, &ev);
+        conn.want_write = want_write;
+    }
+    return true;
+}
+
+bool socket_oracle::receive(size_t c, const std::function<void(size_t, bool)> &done)
+{
+    auto &conn = this->_conns[c];
+    char buf[16384];
+    bool closed = false;
+    for (;;) {
+        ssize_t n = recv(conn.fd, buf, sizeof(buf), 0);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            break;
+        if (n <= 0) {
+            closed = true;
+            break;
+        }
+        conn.in.append(buf, n);
+    }
+
+    // answers that came before the connection was closed still count
+    std::string_view rest(conn.in);
+    while (!conn.pending.empty()) {
+        size_t len = this->_framing(rest);
+        if (len == 0)
+            break;
+        size_t id = conn.pending.front().id;
+        conn.pending.pop_front();
+        --this->_in_flight;
+        ++this->_queries;
+        done(id, this->_is_padded(rest.substr(0, len)));
+        rest.remove_prefix(len);
+    }
+    conn.in.erase(0, conn.in.size() - rest.size());
+    return !closed;
+}
+
+bool socket_oracle::pump(const std::function<bool(task&)> &next, const std::function<void(size_t, bool)> &done)
+{
+    if (!this->_ok)
+        return false;
+
+    size_t retries = 0;
+    // connections closed without any answer in between
+    size_t closes = 0;
+    for (;;) {
+        // fill connections up to pipeline depth, least busy first
+        for (;;) {
+            auto c = std::min_element(this->_conns.begin(), this->_conns.end(),
+                [](const connection &a, const connection &b) { return a.pending.size() < b.pending.size(); });
+            if (c->pending.size() >= this->_opts.pipeline)
+                break;
+            task t;
+            if (!next(t))
+                break;
+            size_t ci = c - this->_conns.begin();
+            this->submit(ci, std::move(t));
+            if (!this->flush(ci) && !this->reconnect(ci))
+                return this->_ok = false;
+        }
+        if (this->_in_flight == 0)
+            return true;
+
+        epoll_event events[16];
+        int n = epoll_wait(this->_epoll, events, 16, this->_opts.timeout.count());
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0)
+            return this->_ok = false;
+
+        if (n == 0) {
+            if (++retries > this->_opts.max_retries)
+                return this->_ok = false;
+            for (size_t c = 0; c < this->_conns.size(); ++c)
+                if (!this->_conns[c].pending.empty() && !this->reconnect(c))
+                    return this->_ok = false;
+            continue;
+        }
+
+        retries = 0;
+        size_t answered = this->_queries;
+        for (int i = 0; i < n; ++i) {
+            size_t c = events[i].data.u64;
+            bool alive = true;
+            if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+                alive = this->receive(c, done);
+            if (alive && (events[i].events & EPOLLOUT))
+                alive = this->flush(c);
+            // server closing a connection is normal (keep-alive limits), server gone is not
+            if (alive)
+                continue;
+            if (this->_queries > answered)
+                closes = 0;
+            if (++closes > this->_opts.max_retries * this->_conns.size() || !this->reconnect(c))
+                return this->_ok = false;
+        }
+    }
+}
+
+bool socket_oracle::operator()(cipher_desc &d)
+{
+    bool sent = false;
+    bool res = false;
+    this->pump(
+        [&](task &t) {
+            if (sent)
+                return false;
+            t.id = 0;
+            t.input = d;
+            return sent = true;
+        },
+        [&](size_t, bool good) { res = good; });
+    return res;
+}
+
+size_t socket_oracle::find_option(std::function<dec_option(uint8_t)> option)
+{
+    size_t next_index = 0;
+    size_t found = 0x100;
+    std::deque<size_t> fp_todo;
+
+    bool ok = this->pump(
+        [&](task &t) {
+            if (!fp_todo.empty()) {
+                size_t i = fp_todo.front();
+                fp_todo.pop_front();
+                t.id = i | fp_flag;
+                t.input = option(i).false_pos_check.value();
+                return true;
+            }
+            if (next_index >= found)
+                return false;
+            t.id = next_index;
+            t.input = option(next_index).option;
+            ++next_index;
+            return true;
+        },
+        [&](size_t id, bool good) {
+            size_t i = id & ~fp_flag;
+            if (!good || i >= found)
+                return;
+            if (!(id & fp_flag) && option(i).false_pos_check)
+                fp_todo.push_back(i);
+            else
+                found = i;
+        });
+    return ok ? found : 0x100;
+}
+
+}
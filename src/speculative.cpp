@@ -0,0 +1,108 @@
+#include <thread>
+#include "porc/speculative.hpp"
+
+namespace porc {
+
+speculative_runner::speculative_runner(std::function<bool(cipher_desc&)> f, size_t confirmations)
+    : _f(f), _confirmations(confirmations)
+{
+}
+
+bool speculative_runner::ask(cipher_desc &d)
+{
+    ++this->_queries;
+    return this->_f(d);
+}
+
+void speculative_runner::search(const decryptor &d, scan &s, const std::atomic<bool> *stop)
+{
+    for (; !s.found && s.next < 0x100 && !(stop && *stop); ++s.next) {
+        if (d.rejected(s.next))
+            continue;
+        auto o = d.option(s.next);
+        ++s.queries;
+        if (this->ask(o.option))
+            s.found = s.next;
+    }
+}
+
+bool speculative_runner::confirm(const dec_option &o)
+{
+    if (o.false_pos_check) {
+        auto fp = o.false_pos_check.value();
+        if (!this->ask(fp))
+            return false;
+    }
+    for (size_t i = 0; i < this->_confirmations; ++i) {
+        auto in = o.option;
+        if (!this->ask(in))
+            return false;
+    }
+    return true;
+}
+
+bool speculative_runner::run(decryptor &d)
+{
+    scan cur;
+    while (d.status() != dec_status::DONE) {
+        if (d.status() == dec_status::VERIFY) {
+            auto v = d.verification();
+            d.verified(this->ask(v));
+            cur = scan();
+            continue;
+        }
+
+        this->search(d, cur, nullptr);
+        if (!cur.found)
+            return false;
+
+        size_t v = cur.found.value();
+        auto o = d.option(v);
+        if (!o.false_pos_check && this->_confirmations == 0) {
+            // nothing to confirm, verification blames these bytes first
+            d.step(v, unconfirmed_confidence);
+            cur = scan();
+            continue;
+        }
+
+        // a step that ends the block goes to cache and on_block, confirm first
+        bool block_end = true;
+        for (size_t i = 0; block_end && i < d.current_byte(); ++i)
+            block_end = d.known(d.current_block(), i);
+        if (block_end) {
+            bool ok = this->confirm(o);
+            if (ok)
+                d.step(v);
+            cur = ok ? scan() : scan { v + 1, std::nullopt, 0 };
+            continue;
+        }
+
+        decryptor next = d;
+        next.step(v);
+        scan spec;
+        std::atomic<bool> stop = false;
+        std::thread t([&]() { this->search(next, spec, &stop); });
+        bool ok = this->confirm(o);
+        stop = true;
+        t.join();
+
+        this->_stats.speculative += spec.queries;
+        if (ok) {
+            d = std::move(next);
+            cur = spec;
+        } else {
+            this->_stats.wasted += spec.queries;
+            cur = scan { v + 1, std::nullopt, 0 };
+        }
+    }
+    return true;
+}
+
+speculative_stats speculative_runner::stats() const
+{
+    speculative_stats res = this->_stats;
+    res.queries = this->_queries;
+    return res;
+}
+
+}
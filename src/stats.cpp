@@ -4,10 +4,12 @@
 
 namespace porc::stats {
 
-uintmax_t mean(const std::vector<int64_t> &v)
+long double mean(const std::vector<int64_t> &v)
 {
     assert(!v.empty());
-    uintmax_t r = 0;
+    // long double holds any sum of int64_t that fits in 64 bits exactly,
+    // longer sums lose precision instead of wrapping around
+    long double r = 0;
     for (auto i : v)
         r += i;
     return r / v.size();
@@ -30,6 +32,118 @@ uintmax_t median(const std::vector<int64_t> &v)
     return r;
 }
 
+namespace {
+
+/*
+    Partition v so that [k, size - k) holds values between k-th smallest and k-th largest
+*/
+void trim(std::vector<int64_t> &v, size_t k)
+{
+    assert(2 * k < v.size());
+    if (k == 0)
+        return;
+    std::nth_element(v.begin(), v.begin() + k, v.end());
+    std::nth_element(v.begin() + k, v.end() - k, v.end());
+}
+
+size_t trim_count(size_t size, long double fraction)
+{
+    assert(fraction >= 0 && fraction < 0.5);
+    return std::min<size_t>(size * fraction, (size - 1) / 2);
+}
+
+}
+
+long double trimmed_mean(std::vector<int64_t> &&v, long double fraction)
+{
+    assert(!v.empty());
+    size_t k = trim_count(v.size(), fraction);
+    trim(v, k);
+    long double r = 0;
+    for (auto i = v.begin() + k; i != v.end() - k; ++i)
+        r += *i;
+    return r / (v.size() - 2 * k);
+}
+
+long double trimmed_mean(const std::vector<int64_t> &v, long double fraction)
+{
+    return trimmed_mean(std::vector<int64_t>(v), fraction);
+}
+
+long double winsorized_mean(std::vector<int64_t> &&v, long double fraction)
+{
+    assert(!v.empty());
+    size_t k = trim_count(v.size(), fraction);
+    trim(v, k);
+    auto [lo, hi] = std::minmax_element(v.begin() + k, v.end() - k);
+    long double r = (long double)k * (*lo + *hi);
+    for (auto i = v.begin() + k; i != v.end() - k; ++i)
+        r += *i;
+    return r / v.size();
+}
+
+long double winsorized_mean(const std::vector<int64_t> &v, long double fraction)
+{
+    return winsorized_mean(std::vector<int64_t>(v), fraction);
+}
+
+int64_t percentile(std::vector<int64_t> &&v, long double p)
+{
+    assert(!v.empty());
+    assert(p >= 0 && p <= 1);
+    auto i = v.begin() + std::min<size_t>(v.size() * p, v.size() - 1);
+    std::nth_element(v.begin(), i, v.end());
+    return *i;
+}
+
+int64_t percentile(const std::vector<int64_t> &v, long double p)
+{
+    return percentile(std::vector<int64_t>(v), p);
+}
+
+int64_t min_of_k(const std::vector<int64_t> &v, size_t k)
+{
+    assert(!v.empty() && k > 0);
+    std::vector<int64_t> mins;
+    for (size_t i = 0; i < v.size(); i += k)
+        mins.push_back(*std::min_element(v.begin() + i, v.begin() + std::min(i + k, v.size())));
+    return percentile(std::move(mins), 0.5);
+}
+
+long double mad(std::vector<int64_t> &&v)
+{
+    assert(!v.empty());
+    auto mid = v.begin() + v.size() / 2;
+    std::nth_element(v.begin(), mid, v.end());
+    int64_t med = *mid;
+    for (auto &i : v)
+        i = i > med ? i - med : med - i;
+    std::nth_element(v.begin(), mid, v.end());
+    return *mid;
+}
+
+long double mad(const std::vector<int64_t> &v)
+{
+    return mad(std::vector<int64_t>(v));
+}
+
+std::vector<int64_t> iqr_filter(const std::vector<int64_t> &v, long double k)
+{
+    assert(!v.empty());
+    std::vector<int64_t> tmp(v);
+    auto q1 = tmp.begin() + tmp.size() / 4;
+    auto q3 = tmp.begin() + std::min(tmp.size() * 3 / 4, tmp.size() - 1);
+    std::nth_element(tmp.begin(), q1, tmp.end());
+    std::nth_element(q1, q3, tmp.end());
+
+    long double iqr = *q3 - *q1;
+    long double lo = *q1 - k * iqr;
+    long double hi = *q3 + k * iqr;
+    std::vector<int64_t> res;
+    std::copy_if(v.begin(), v.end(), std::back_inserter(res), [=](int64_t i) { return i >= lo && i <= hi; });
+    return res;
+}
+
 long double covariance(const std::vector<int64_t> a, const std::vector<int64_t> &b)
 {
     assert(a.size() == b.size());
@@ -70,6 +184,176 @@ long double corrcoef(const std::vector<int64_t> &a, const std::vector<int64_t> &
     return covariance(a,b) / (standard_deviation(a) * standard_deviation(b));
 }
 
+std::vector<long double> robust_z(const std::vector<long double> &v)
+{
+    assert(!v.empty());
+    std::vector<long double> tmp(v);
+    auto mid = tmp.begin() + tmp.size() / 2;
+    std::nth_element(tmp.begin(), mid, tmp.end());
+    long double med = *mid;
+
+    for (size_t i = 0; i < v.size(); ++i)
+        tmp[i] = std::fabs(v[i] - med);
+    std::nth_element(tmp.begin(), mid, tmp.end());
+    long double mad = *mid;
+    if (mad == 0) {
+        mad = INFINITY;
+        for (auto d : tmp)
+            if (d > 0)
+                mad = std::min(mad, d);
+    }
+
+    std::vector<long double> res;
+    for (auto i : v)
+        res.push_back((i - med) / (1.4826 * mad));
+    return res;
+}
+
+std::vector<size_t> outliers(const std::vector<std::vector<int64_t>> &samples, long double threshold)
+{
+    std::vector<long double> medians;
+    for (auto &s : samples)
+        medians.push_back(median(s));
+    auto z = robust_z(medians);
+
+    std::vector<size_t> res;
+    for (size_t i = 0; i < z.size(); ++i)
+        if (std::fabs(z[i]) > threshold)
+            res.push_back(i);
+    std::sort(res.begin(), res.end(), [&](size_t a, size_t b) { return std::fabs(z[a]) > std::fabs(z[b]); });
+    return res;
+}
+
+long double normal_cdf(long double x)
+{
+    return std::erfc(-x / std::sqrt(2.0L)) / 2;
+}
+
+long double normal_quantile(long double p)
+{
+    assert(p > 0 && p < 1);
+    // P. J. Acklam's rational approximation, refined with one Newton step
+    static const long double a[] = {
+        -3.969683028665376e+01, 2.209460984245205e+02, -2.759285104469687e+02,
+        1.383577518672690e+02, -3.066479806614716e+01, 2.506628277459239e+00
+    };
+    static const long double b[] = {
+        -5.447609879822406e+01, 1.615858368580409e+02, -1.556989798598866e+02,
+        6.680131188771972e+01, -1.328068155288572e+01
+    };
+    static const long double c[] = {
+        -7.784894002430293e-03, -3.223964580411365e-01, -2.400758277161838e+00,
+        -2.549732539343734e+00, 4.374664141464968e+00, 2.938163982698783e+00
+    };
+    static const long double d[] = {
+        7.784695709041462e-03, 3.224671290700398e-01, 2.445134137142996e+00,
+        3.754408661907416e+00
+    };
+    const long double low = 0.02425;
+
+    long double x;
+    if (p < low || p > 1 - low) {
+        long double q = std::sqrt(-2 * std::log(p < low ? p : 1 - p));
+        x = (((((c[0] * q + c[1]) * q + c[2]) * q + c[3]) * q + c[4]) * q + c[5])
+            / ((((d[0] * q + d[1]) * q + d[2]) * q + d[3]) * q + 1);
+        if (p > 1 - low)
+            x = -x;
+    } else {
+        long double q = p - 0.5;
+        long double r = q * q;
+        x = (((((a[0] * r + a[1]) * r + a[2]) * r + a[3]) * r + a[4]) * r + a[5]) * q
+            / (((((b[0] * r + b[1]) * r + b[2]) * r + b[3]) * r + b[4]) * r + 1);
+    }
+
+    long double e = normal_cdf(x) - p;
+    return x - e * std::sqrt(2 * M_PI) * std::exp(x * x / 2);
+}
+
+namespace {
+
+// larger sample counts are reported as SIZE_MAX
+const long double max_samples = 1e12;
+
+}
+
+calibration calibrate(
+    const std::vector<int64_t> &good,
+    const std::vector<int64_t> &bad,
+    long double byte_error_rate,
+    size_t options)
+{
+    assert(byte_error_rate > 0 && byte_error_rate < 1);
+    assert(options > 0);
+
+    calibration c;
+    c.good_mean = mean(good);
+    c.bad_mean = mean(bad);
+    long double sg = standard_deviation(good);
+    long double sb = standard_deviation(bad);
+    c.sd = std::sqrt((sg * sg + sb * sb) / 2);
+    c.threshold = (c.good_mean + c.bad_mean) / 2;
+    c.greater_good = c.good_mean > c.bad_mean;
+
+    long double diff = std::fabs(c.good_mean - c.bad_mean);
+    if (diff == 0) {
+        c.samples = std::numeric_limits<size_t>::max();
+        c.expected_queries = c.expected_time = INFINITY;
+        return c;
+    }
+    c.effect_size = c.sd > 0 ? diff / c.sd : INFINITY;
+
+    // any of the options can be misclassified, so each gets its share of error rate.
+    // Mean of n measurements is off by diff / 2 with probability normal_cdf(-effect_size * sqrt(n) / 2)
+    long double z = normal_quantile(1 - byte_error_rate / options);
+    long double n = std::ceil(std::pow(2 * z / c.effect_size, 2));
+    // too many to convert to size_t (or to ever measure), as good as no difference
+    if (!(n < max_samples)) {
+        c.samples = std::numeric_limits<size_t>::max();
+        c.expected_queries = c.expected_time = INFINITY;
+        return c;
+    }
+    c.samples = std::max<long double>(1, n);
+
+    c.expected_queries = (options + 1) / 2.0L * c.samples;
+    c.expected_time = c.expected_queries * (c.bad_mean * (options - 1) + c.good_mean) / options;
+    return c;
+}
+
+paired_summary paired(const paired_samples &p)
+{
+    assert(!p.diffs.empty());
+    assert(p.diffs.size() == p.candidate_first.size());
+
+    paired_summary s;
+    long double first = 0, second = 0;
+    size_t first_count = 0, positive = 0;
+    for (size_t i = 0; i < p.diffs.size(); ++i) {
+        s.mean += p.diffs[i];
+        positive += p.diffs[i] > 0;
+        if (p.candidate_first[i]) {
+            first += p.diffs[i];
+            ++first_count;
+        } else {
+            second += p.diffs[i];
+        }
+    }
+    size_t n = p.diffs.size();
+    s.mean /= n;
+    s.median = percentile(p.diffs, 0.5);
+    s.positive = (long double)positive / n;
+    if (first_count != 0 && first_count != n)
+        s.order_bias = first / first_count - second / (n - first_count);
+
+    for (auto d : p.diffs)
+        s.sd += (d - s.mean) * (d - s.mean);
+    s.sd = n > 1 ? std::sqrt(s.sd / (n - 1)) : 0;
+    if (s.sd > 0)
+        s.t = s.mean / (s.sd / std::sqrt((long double)n));
+    else if (s.mean != 0)
+        s.t = std::copysign(INFINITY, s.mean);
+    return s;
+}
+
 bucket_distribution::bucket_distribution(int64_t min, int64_t max, size_t bucket_count, const std::vector<int64_t> &values)
     : _min(min), _max(max), _bucket_step((max - min) / bucket_count)
 {
@@ -0,0 +1,148 @@
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <pthread.h>
+#include <sched.h>
+#include "porc/stats.hpp"
+#include "porc/timing_pool.hpp"
+
+namespace porc {
+
+timing_pool::timing_pool(timed_f f, const cipher_desc &good, const cipher_desc &bad,
+                         const timing_pool_options &opts)
+    : _f(f), _good(good), _bad(bad), _opts(opts)
+{
+    assert(this->_opts.samples > 0);
+    assert(this->_opts.batch > 0);
+    size_t n = std::max<size_t>(this->_opts.workers, 1);
+    this->_results.resize(n);
+    for (size_t i = 0; i < n; ++i)
+        this->_threads.emplace_back(&timing_pool::worker_loop, this, i);
+}
+
+timing_pool::~timing_pool()
+{
+    {
+        std::lock_guard<std::mutex> lock(this->_mutex);
+        this->_stop = true;
+    }
+    this->_cv.notify_all();
+    for (auto &t : this->_threads)
+        t.join();
+}
+
+void timing_pool::worker_loop(size_t worker)
+{
+    if (this->_opts.pin) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(worker % std::max<size_t>(std::thread::hardware_concurrency(), 1), &set);
+        pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    }
+
+    size_t seen = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(this->_mutex);
+            this->_cv.wait(lock, [&] { return this->_stop || this->_job != seen; });
+            if (this->_stop)
+                return;
+            seen = this->_job;
+        }
+
+        this->measure(worker);
+
+        std::lock_guard<std::mutex> lock(this->_mutex);
+        if (++this->_done == this->_threads.size())
+            this->_cv.notify_all();
+    }
+}
+
+void timing_pool::measure(size_t worker)
+{
+    auto &inputs = *this->_inputs;
+    // baselines go first, interleaved with the inputs in every round
+    std::vector<const cipher_desc*> all = { &this->_good, &this->_bad };
+    for (auto &in : inputs)
+        all.push_back(&in);
+
+    std::vector<std::vector<int64_t>> m(all.size());
+    for (size_t s = 0; s < this->_opts.samples; ++s) {
+        for (size_t i = 0; i < all.size(); ++i) {
+            auto start = std::chrono::high_resolution_clock::now();
+            this->_f(all[i]->iv, all[i]->ciphertext);
+            auto end = std::chrono::high_resolution_clock::now();
+            m[i].push_back(std::chrono::nanoseconds(end - start).count());
+        }
+    }
+
+    double good = stats::median(std::move(m[0]));
+    double bad = stats::median(std::move(m[1]));
+    auto &res = this->_results[worker];
+    res.assign(inputs.size(), std::numeric_limits<double>::quiet_NaN());
+    if (good == bad)
+        return;
+    for (size_t i = 0; i < inputs.size(); ++i)
+        res[i] = (stats::median(std::move(m[i + 2])) - bad) / (good - bad);
+}
+
+std::vector<double> timing_pool::scores(const std::vector<cipher_desc> &inputs)
+{
+    {
+        std::unique_lock<std::mutex> lock(this->_mutex);
+        this->_inputs = &inputs;
+        this->_done = 0;
+        ++this->_job;
+        this->_cv.notify_all();
+        this->_cv.wait(lock, [this] { return this->_done == this->_threads.size(); });
+        this->_inputs = nullptr;
+    }
+
+    std::vector<double> res(inputs.size(), std::numeric_limits<double>::quiet_NaN());
+    std::vector<double> per_worker;
+    for (size_t i = 0; i < inputs.size(); ++i) {
+        per_worker.clear();
+        for (auto &r : this->_results)
+            if (!std::isnan(r[i]))
+                per_worker.push_back(r[i]);
+        if (per_worker.empty())
+            continue;
+        auto mid = per_worker.begin() + per_worker.size() / 2;
+        std::nth_element(per_worker.begin(), mid, per_worker.end());
+        res[i] = *mid;
+    }
+    return res;
+}
+
+bool timing_pool::is_padded(const cipher_desc &d)
+{
+    return this->scores({ d })[0] > 0.5;
+}
+
+size_t timing_pool::find_option(std::function<dec_option(uint8_t)> option)
+{
+    for (size_t first = 0; first < 0x100; first += this->_opts.batch) {
+        size_t last = std::min<size_t>(first + this->_opts.batch, 0x100);
+        std::vector<dec_option> opts;
+        std::vector<cipher_desc> inputs;
+        for (size_t v = first; v < last; ++v) {
+            opts.push_back(option(v));
+            inputs.push_back(opts.back().option);
+        }
+
+        auto s = this->scores(inputs);
+        // best first, NaN never passes
+        std::vector<size_t> order;
+        for (size_t i = 0; i < s.size(); ++i)
+            if (s[i] > 0.5)
+                order.push_back(i);
+        std::sort(order.begin(), order.end(), [&s](size_t a, size_t b) { return s[a] > s[b]; });
+        for (auto i : order)
+            if (!opts[i].false_pos_check || this->is_padded(opts[i].false_pos_check.value()))
+                return opts[i].index;
+    }
+    return 0x100;
+}
+
+}